@@ -57,13 +57,13 @@ bool GameController::initialize() {
 }
 
 void GameController::handleKeyboardInput(GLFWwindow* window) {
-    float walkSpeed = 2.5f;
-    float runSpeed = 5.0f;
-    float speed = walkSpeed * deltaTime;
+    // Only used when no animated character provides root motion
+    float fallbackWalkSpeed = 2.5f;
+    float fallbackRunSpeed = 5.0f;
+    float fallbackCrouchSpeed = 1.2f;
 
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
-        speed = runSpeed * deltaTime;
-    }
+    bool crouching = glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS;
+    bool running = !crouching && glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
 
     glm::vec3 flatFront = glm::normalize(glm::vec3(cameraFront.x, 0.0f, cameraFront.z));
     glm::vec3 forward = glm::normalize(glm::vec3(
@@ -73,10 +73,49 @@ void GameController::handleKeyboardInput(GLFWwindow* window) {
     ));
     glm::vec3 right = glm::normalize(glm::cross(forward, cameraUp));
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) cameraPos += flatFront * speed;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) cameraPos -= flatFront * speed;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) cameraPos -= right * speed;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) cameraPos += right * speed;
+    bool forwardKey = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    bool backwardKey = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    bool leftKey = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    bool rightKey = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    int forwardAxis = int(forwardKey) - int(backwardKey);
+    int rightAxis = int(rightKey) - int(leftKey);
+
+    if (forwardAxis != 0) {
+        moveDirection = forwardAxis > 0 ? MoveDirection::Forward : MoveDirection::Backward;
+    } else if (rightAxis != 0) {
+        moveDirection = rightAxis > 0 ? MoveDirection::Right : MoveDirection::Left;
+    }
+
+    glm::vec3 direction = flatFront * float(forwardAxis) + right * float(rightAxis);
+    if (glm::length(direction) > 0.0f) {
+        direction = glm::normalize(direction);
+        if (hasRootMotion) {
+            // Each direction plays its own clip, so its travel already points the right way.
+            // Diagonals play the forward or backward clip, turned 45 degrees onto the keys
+            glm::vec3 travel(rootMotion.x, 0.0f, rootMotion.z);
+            if (forwardAxis != 0 && rightAxis != 0) {
+                travel = direction * glm::length(travel);
+            }
+            cameraPos += travel;
+        } else {
+            float speed = crouching ? fallbackCrouchSpeed : running ? fallbackRunSpeed : fallbackWalkSpeed;
+            cameraPos += direction * speed * deltaTime;
+        }
+    }
+    hasRootMotion = false;
+
+    bool moving =
+        glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    if (crouching) {
+        locomotion = moving ? Locomotion::CrouchWalk : Locomotion::Crouch;
+    } else if (moving) {
+        locomotion = running ? Locomotion::Run : Locomotion::Walk;
+    } else {
+        locomotion = Locomotion::Idle;
+    }
 
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && onGround) {
         velocity.y = jumpVelocity;
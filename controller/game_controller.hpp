@@ -6,6 +6,24 @@
 #include <memory>
 #include "../model/audio_manager.hpp"
 
+// What the player's legs are doing, for the character animation
+enum class Locomotion {
+    Idle,
+    Walk,
+    Run,
+    Crouch,
+    CrouchWalk
+};
+
+// Which way the held movement keys point, relative to where the player faces.
+// Diagonals count as forward or backward
+enum class MoveDirection {
+    Forward,
+    Backward,
+    Left,
+    Right
+};
+
 class GameController {
 private:
     std::shared_ptr<AudioManager> audioManager;
@@ -23,6 +41,10 @@ private:
     const float jumpVelocity;
     
     bool isWalking;
+    Locomotion locomotion = Locomotion::Idle;
+    MoveDirection moveDirection = MoveDirection::Forward;
+    glm::vec3 rootMotion{0.0f};   // world displacement from the animation
+    bool hasRootMotion = false;
 
     bool isShooting;
     float shootCooldown;
@@ -67,6 +89,12 @@ public:
     
     float getDeltaTime() const { return deltaTime; }
     float getYaw() const { return yaw; }
+    Locomotion getLocomotion() const { return locomotion; }
+    MoveDirection getMoveDirection() const { return moveDirection; }
+    // World displacement of the character's clips last frame; movement uses it
+    // instead of fixed speeds. Not set while the clips carry no root motion
+    void setRootMotion(const glm::vec3& displacement) { rootMotion = displacement; hasRootMotion = true; }
+    bool isFiring() const { return isShooting; }
     float getPitch() const { return pitch; }
     
     void updateDeltaTime();
@@ -2,9 +2,14 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <cctype>
 
 #include "controller/game_controller.hpp"
 #include "view/renderer.hpp"
+#include "view/texture_compressor.hpp"
+#include "view/animation/animation_system.hpp"
+#include "view/animation/baked_animation.hpp"
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
     auto* controller = static_cast<GameController*>(glfwGetWindowUserPointer(window));
@@ -16,7 +21,33 @@ void mouseMoveCallback(GLFWwindow* window, double xpos, double ypos) {
     controller->onMouseMove(window, xpos, ypos);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Offline step, no window needed: encode every skin texture to BC1/BC3 KTX
+    if (argc > 1 && std::string(argv[1]) == "--cook-textures") {
+        return cookTextureDirectory("view/resources/skins") ? 0 : 1;
+    }
+
+    // Offline step: sample the crowd's clips into bone palette textures
+    if (argc > 1 && std::string(argv[1]) == "--bake-animations") {
+        return bakeCharacterAnimations("view/resources/skins/men/yahya/everyday.fbx", {"idle", "walking"}) ? 0 : 1;
+    }
+
+    // Offline step: keyframe search cost of clip imports, with and without key cursors
+    if (argc > 1 && std::string(argv[1]) == "--profile-keyframes") {
+        return profileKeyframeSearch("view/resources/skins/men/yahya/animations") ? 0 : 1;
+    }
+
+    // Offline step: skinning error of the packed vertex layout against full precision
+    if (argc > 1 && std::string(argv[1]) == "--check-vertex-packing") {
+        return checkVertexPacking("view/resources/skins/men/yahya/everyday.fbx",
+            "view/resources/skins/men/yahya/animations/everyday_walking.fbx") ? 0 : 1;
+    }
+
+    // Offline step: pose kernel timings, then animation cost of 100 characters on 1 to N cores
+    if (argc > 1 && std::string(argv[1]) == "--profile-animation") {
+        return profileAnimation("view/resources/skins/men/yahya/everyday.fbx", 100) ? 0 : 1;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -52,6 +83,25 @@ int main() {
 
     renderer->initialiseGLText();
 
+    // Development mode: edited skins, animations and textures reload while running
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--dev") {
+            renderer->enableHotReload("view/resources");
+        }
+        // Skins the animated character with dual quaternions instead of matrices
+        if (std::string(argv[i]) == "--dual-quaternion") {
+            renderer->setCharacterSkinning(SkinningMode::DualQuaternion);
+        }
+        // Benchmark scene: a crowd of baked characters, 500 unless a count follows
+        if (std::string(argv[i]) == "--crowd") {
+            size_t count = 500;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                count = std::stoul(argv[++i]);
+            }
+            renderer->spawnCrowd(count);
+        }
+    }
+
     glfwSetWindowUserPointer(window, controller.get());
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
     glfwSetCursorPosCallback(window, mouseMoveCallback);
@@ -80,6 +130,9 @@ int main() {
 
     renderer->cleanText();
 
+    // GPU resources must be released while the context is still alive
+    renderer.reset();
+
     glfwTerminate();
     return 0;
 }
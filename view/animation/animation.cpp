@@ -1,7 +1,20 @@
 #include "animation.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <random>
+
+// Frames per second clips are resampled to at import
+constexpr float RESAMPLE_RATE = 30.0f;
+
+// Net hips travel over a loop, in clip units (cm for the skins), below which
+// a clip counts as in place and keeps its hips motion in the pose
+constexpr float ROOT_MOTION_MIN_TRAVEL = 10.0f;
 
 Animation::Animation(const aiScene* scene, const std::string& animationName) : name(animationName) {
     for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
@@ -9,6 +22,7 @@ Animation::Animation(const aiScene* scene, const std::string& animationName) : n
         if (animation->mName.length > 0) {
             std::string animName = animation->mName.C_Str();
             if (animName == animationName || animationName.empty()) {
+                name = animName;
                 processAnimation(animation);
                 break;
             }
@@ -24,13 +38,16 @@ void Animation::processAnimation(const aiAnimation* animation) {
     duration = animation->mDuration;
     ticksPerSecond = (animation->mTicksPerSecond != 0) ? animation->mTicksPerSecond : 25.0f;
     
+    std::vector<AnimationNode> nodes;
     for (unsigned int i = 0; i < animation->mNumChannels; i++) {
         aiNodeAnim* nodeAnim = animation->mChannels[i];
-        processAnimationNode(nodeAnim);
+        nodes.push_back(processAnimationNode(nodeAnim));
     }
+
+    resample(nodes);
 }
 
-void Animation::processAnimationNode(const aiNodeAnim* nodeAnim) {
+AnimationNode Animation::processAnimationNode(const aiNodeAnim* nodeAnim) {
     AnimationNode node;
     node.name = nodeAnim->mNodeName.C_Str();
     
@@ -61,58 +78,290 @@ void Animation::processAnimationNode(const aiNodeAnim* nodeAnim) {
         node.scales.push_back(keyScale);
     }
     
-    animationNodes[node.name] = node;
+    return node;
 }
 
-glm::mat4 AnimationNode::getLocalTransform(float animationTime) const {
-    glm::vec3 position = interpolatePosition(animationTime);
-    glm::quat rotation = interpolateRotation(animationTime);
-    glm::vec3 scale = interpolateScaling(animationTime);
-    
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), position);
-    glm::mat4 rotation_mat = glm::toMat4(rotation);
-    glm::mat4 scale_mat = glm::scale(glm::mat4(1.0f), scale);
-    
-    return translation * rotation_mat * scale_mat;
+void Animation::resample(const std::vector<AnimationNode>& nodes) {
+    size_t trackCount = nodes.size();
+    size_t keyBytes = 0;
+    trackNames.clear();
+    for (const auto& node : nodes) {
+        trackNames.push_back(node.name);
+        keyBytes += node.positions.size() * sizeof(KeyPosition) + node.rotations.size() * sizeof(KeyRotation) +
+                    node.scales.size() * sizeof(KeyScale);
+    }
+
+    // One frame every 1/RESAMPLE_RATE s, plus one landing exactly on the end
+    RawClip raw;
+    frameTicks = ticksPerSecond / RESAMPLE_RATE;
+    raw.trackCount = trackCount;
+    raw.frameCount = static_cast<size_t>(std::ceil(duration / frameTicks)) + 1;
+    raw.translations.resize(raw.frameCount * trackCount);
+    raw.rotations.resize(raw.frameCount * trackCount);
+    raw.scales.resize(raw.frameCount * trackCount);
+
+    // Sweeping each track in time order keeps the key searches O(1)
+    for (size_t track = 0; track < trackCount; track++) {
+        KeyframeCursor cursor;
+        for (size_t frame = 0; frame < raw.frameCount; frame++) {
+            float time = std::min(frame * frameTicks, duration);
+            size_t slot = frame * trackCount + track;
+            raw.translations[slot] = nodes[track].interpolatePosition(time, cursor.position);
+            raw.rotations[slot] = nodes[track].interpolateRotation(time, cursor.rotation);
+            raw.scales[slot] = nodes[track].interpolateScaling(time, cursor.scale);
+        }
+    }
+
+    extractRootMotion(raw);
+    clip = compressClip(raw, ClipCompressionSettings());
+    ClipCompressionReport report = measureClipError(raw, clip);
+    size_t rawBytes = raw.translations.size() * sizeof(glm::vec3) + raw.rotations.size() * sizeof(glm::quat) +
+                      raw.scales.size() * sizeof(glm::vec3);
+
+    std::cout << "Compressed clip " << name << ": " << trackCount << " tracks, " << clip.keptFrames.size() << " of "
+              << raw.frameCount << " frames at " << RESAMPLE_RATE << " Hz kept, "
+              << clip.animatedTranslations.size() << "/" << clip.animatedRotations.size() << "/" << clip.animatedScales.size()
+              << " animated T/R/S channels, " << memoryBytes() / 1024 << " KB ("
+              << float(keyBytes) / std::max<size_t>(memoryBytes(), 1) << "x smaller than the keys, "
+              << float(rawBytes) / std::max<size_t>(memoryBytes(), 1) << "x than resampled), max error "
+              << report.maxRotationError << " deg / " << report.maxTranslationError << " units" << std::endl;
 }
 
-int AnimationNode::getPositionIndex(float animationTime) const {
-    for (unsigned int i = 0; i < positions.size() - 1; i++) {
-        if (animationTime < positions[i + 1].timeStamp)
-            return i;
+void Animation::extractRootMotion(RawClip& raw) {
+    rootMotion.clear();
+    int hips = -1;
+    for (size_t track = 0; track < trackNames.size(); track++) {
+        const std::string& trackName = trackNames[track];
+        if (trackName.size() >= 4 && trackName.compare(trackName.size() - 4, 4, "Hips") == 0) {
+            hips = static_cast<int>(track);
+            break;
+        }
     }
-    return positions.size() - 1;
+    if (hips < 0 || raw.frameCount < 2)
+        return;
+
+    glm::vec3 start = raw.translations[hips];
+    glm::vec3 end = raw.translations[(raw.frameCount - 1) * raw.trackCount + hips];
+    if (glm::length(glm::vec2(end.x - start.x, end.z - start.z)) < ROOT_MOTION_MIN_TRAVEL)
+        return;
+
+    // Height stays in the pose; the simulation moves the character over the ground
+    rootMotion.resize(raw.frameCount);
+    for (size_t frame = 0; frame < raw.frameCount; frame++) {
+        glm::vec3& hipsPosition = raw.translations[frame * raw.trackCount + hips];
+        rootMotion[frame] = glm::vec3(hipsPosition.x - start.x, 0.0f, hipsPosition.z - start.z);
+        hipsPosition.x = start.x;
+        hipsPosition.z = start.z;
+    }
+    std::cout << "Clip " << name << ": root motion of " << glm::length(rootMotion.back()) << " units per loop" << std::endl;
+}
+
+glm::vec3 Animation::rootOffset(float animationTime) const {
+    float position = glm::clamp(animationTime / frameTicks, 0.0f, static_cast<float>(rootMotion.size() - 1));
+    size_t frame = std::min(static_cast<size_t>(position), rootMotion.size() - 2);
+    return glm::mix(rootMotion[frame], rootMotion[frame + 1], position - frame);
 }
 
-int AnimationNode::getRotationIndex(float animationTime) const {
-    for (unsigned int i = 0; i < rotations.size() - 1; i++) {
-        if (animationTime < rotations[i + 1].timeStamp)
-            return i;
+glm::vec3 Animation::getRootMotion(float fromTime, float toTime) const {
+    if (rootMotion.empty())
+        return glm::vec3(0.0f);
+    if (toTime >= fromTime)
+        return rootOffset(toTime) - rootOffset(fromTime);
+    return rootMotion.back() - rootOffset(fromTime) + rootOffset(toTime);
+}
+
+size_t Animation::memoryBytes() const {
+    return clip.memoryBytes() + rootMotion.size() * sizeof(glm::vec3);
+}
+
+void Animation::samplePose(float animationTime, Pose& pose) const {
+    sampleClip(clip, animationTime / frameTicks, pose);
+}
+
+namespace {
+
+// Forward steps tried from the cursor before falling back to a binary search
+constexpr int CURSOR_MAX_STEPS = 4;
+
+// Index of the key starting the segment that contains animationTime. Normal
+// playback is found within a step or two of the cursor; a loop, seek or clip
+// change binary searches instead of scanning from key 0
+template <typename Key>
+int findKeyIndex(const std::vector<Key>& keys, float animationTime, int& cursor) {
+    int last = static_cast<int>(keys.size()) - 1;
+    int index = std::clamp(cursor, 0, last);
+
+    if (animationTime >= keys[index].timeStamp) {
+        for (int step = 0; step < CURSOR_MAX_STEPS && index < last && animationTime >= keys[index + 1].timeStamp; step++)
+            index++;
+        if (index == last || animationTime < keys[index + 1].timeStamp) {
+            cursor = index;
+            return index;
+        }
     }
-    return rotations.size() - 1;
+
+    auto next = std::upper_bound(keys.begin() + 1, keys.end(), animationTime,
+        [](float time, const Key& key) { return time < key.timeStamp; });
+    index = static_cast<int>(next - keys.begin()) - 1;
+    cursor = index;
+    return index;
 }
 
-int AnimationNode::getScaleIndex(float animationTime) const {
-    for (unsigned int i = 0; i < scales.size() - 1; i++) {
-        if (animationTime < scales[i + 1].timeStamp)
-            return i;
+// The search findKeyIndex replaced, the baseline of profileKeyframeSearch
+template <typename Key>
+int findKeyIndexLinear(const std::vector<Key>& keys, float animationTime) {
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+        if (animationTime < keys[i + 1].timeStamp)
+            return static_cast<int>(i);
+    }
+    return static_cast<int>(keys.size()) - 1;
+}
+
+// Searches every track at each time in order, as resample() does; returns ns
+// per search. Tracks carry a key of each kind, as Assimp imports them
+template <typename Search>
+double timeKeySearch(const std::vector<AnimationNode>& nodes, const std::vector<float>& times, Search search,
+    long long& sink) {
+    const int repeats = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        for (const auto& node : nodes) {
+            KeyframeCursor cursor;
+            for (float time : times)
+                sink += search(node, time, cursor);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (3.0 * repeats * nodes.size() * times.size());
+}
+
+}
+
+bool profileKeyframeSearch(const std::string& clipDirectory) {
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(clipDirectory, error)) {
+        if (entry.path().extension() == ".fbx")
+            paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    auto linearSearch = [](const AnimationNode& node, float time, KeyframeCursor&) {
+        return findKeyIndexLinear(node.positions, time) + findKeyIndexLinear(node.rotations, time) +
+               findKeyIndexLinear(node.scales, time);
+    };
+    auto cursorSearch = [](const AnimationNode& node, float time, KeyframeCursor& cursor) {
+        return findKeyIndex(node.positions, time, cursor.position) + findKeyIndex(node.rotations, time, cursor.rotation) +
+               findKeyIndex(node.scales, time, cursor.scale);
+    };
+
+    // Sweep: the resampling at import. Seek: as many samples at random times
+    std::mt19937 random(1);
+    double sweepLinearNs = 0.0, sweepCursorNs = 0.0, seekLinearNs = 0.0, seekCursorNs = 0.0;
+    size_t clipCount = 0, trackCount = 0, keyCount = 0;
+    long long sink = 0;
+    for (const auto& path : paths) {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, 0);
+        if (!scene || !scene->HasAnimations()) {
+            std::cerr << "No animation in " << path << std::endl;
+            continue;
+        }
+        const aiAnimation* animation = scene->mAnimations[0];
+        float duration = static_cast<float>(animation->mDuration);
+        float ticksPerSecond = animation->mTicksPerSecond != 0 ? static_cast<float>(animation->mTicksPerSecond) : 25.0f;
+
+        std::vector<AnimationNode> nodes;
+        for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+            AnimationNode node = Animation::processAnimationNode(animation->mChannels[i]);
+            if (!node.positions.empty() && !node.rotations.empty() && !node.scales.empty()) {
+                keyCount += node.positions.size();
+                nodes.push_back(std::move(node));
+            }
+        }
+        if (nodes.empty())
+            continue;
+
+        float frameTicks = ticksPerSecond / RESAMPLE_RATE;
+        size_t frameCount = static_cast<size_t>(std::ceil(duration / frameTicks)) + 1;
+        std::uniform_real_distribution<float> anyTime(0.0f, duration);
+        std::vector<float> sweep(frameCount), seeks(frameCount);
+        for (size_t frame = 0; frame < frameCount; frame++) {
+            sweep[frame] = std::min(frame * frameTicks, duration);
+            seeks[frame] = anyTime(random);
+        }
+
+        for (const auto& node : nodes) {
+            KeyframeCursor sweepKeys, seekKeys;
+            for (size_t frame = 0; frame < frameCount; frame++) {
+                if (linearSearch(node, sweep[frame], sweepKeys) != cursorSearch(node, sweep[frame], sweepKeys) ||
+                    linearSearch(node, seeks[frame], seekKeys) != cursorSearch(node, seeks[frame], seekKeys)) {
+                    std::cerr << "Key cursor and linear scan disagree on " << node.name << " in " << path << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        sweepLinearNs += timeKeySearch(nodes, sweep, linearSearch, sink);
+        sweepCursorNs += timeKeySearch(nodes, sweep, cursorSearch, sink);
+        seekLinearNs += timeKeySearch(nodes, seeks, linearSearch, sink);
+        seekCursorNs += timeKeySearch(nodes, seeks, cursorSearch, sink);
+        clipCount++;
+        trackCount += nodes.size();
     }
-    return scales.size() - 1;
+    if (clipCount == 0)
+        return false;
+
+    std::cout << "Keyframe search over " << clipCount << " clips, " << trackCount << " tracks, "
+              << keyCount / trackCount << " keys per track on average (checksum " << sink << ")" << std::endl;
+    std::cout << "Resampling sweep: " << sweepLinearNs / clipCount << " ns per search with the linear scan, "
+              << sweepCursorNs / clipCount << " ns with cursors" << std::endl;
+    std::cout << "Random seeks: " << seekLinearNs / clipCount << " ns per search with the linear scan, "
+              << seekCursorNs / clipCount << " ns with cursors" << std::endl;
+    return true;
+}
+
+glm::mat4 AnimationNode::getLocalTransform(float animationTime) const {
+    KeyframeCursor cursor;
+    return getLocalTransform(animationTime, cursor);
+}
+
+glm::mat4 AnimationNode::getLocalTransform(float animationTime, KeyframeCursor& cursor) const {
+    glm::vec3 position = interpolatePosition(animationTime, cursor.position);
+    glm::quat rotation = interpolateRotation(animationTime, cursor.rotation);
+    glm::vec3 scale = interpolateScaling(animationTime, cursor.scale);
+    
+    return toMat4(composeAffine(position, rotation, scale));
+}
+
+int AnimationNode::getPositionIndex(float animationTime, int& cursor) const {
+    return findKeyIndex(positions, animationTime, cursor);
+}
+
+int AnimationNode::getRotationIndex(float animationTime, int& cursor) const {
+    return findKeyIndex(rotations, animationTime, cursor);
+}
+
+int AnimationNode::getScaleIndex(float animationTime, int& cursor) const {
+    return findKeyIndex(scales, animationTime, cursor);
 }
 
 float AnimationNode::getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const {
     float scaleFactor = 0.0f;
     float midWayLength = animationTime - lastTimeStamp;
     float framesDiff = nextTimeStamp - lastTimeStamp;
+    // Past the last key both ends are the same key
+    if (framesDiff <= 0.0f)
+        return 0.0f;
     scaleFactor = midWayLength / framesDiff;
     return scaleFactor;
 }
 
-glm::vec3 AnimationNode::interpolatePosition(float animationTime) const {
+glm::vec3 AnimationNode::interpolatePosition(float animationTime, int& cursor) const {
     if (positions.size() == 1)
         return positions[0].position;
     
-    int p0Index = getPositionIndex(animationTime);
+    int p0Index = getPositionIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     if (p1Index >= positions.size())
         p1Index = p0Index;
@@ -122,11 +371,11 @@ glm::vec3 AnimationNode::interpolatePosition(float animationTime) const {
     return finalPosition;
 }
 
-glm::quat AnimationNode::interpolateRotation(float animationTime) const {
+glm::quat AnimationNode::interpolateRotation(float animationTime, int& cursor) const {
     if (rotations.size() == 1)
         return rotations[0].orientation;
     
-    int p0Index = getRotationIndex(animationTime);
+    int p0Index = getRotationIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     if (p1Index >= rotations.size())
         p1Index = p0Index;
@@ -137,11 +386,11 @@ glm::quat AnimationNode::interpolateRotation(float animationTime) const {
     return finalRotation;
 }
 
-glm::vec3 AnimationNode::interpolateScaling(float animationTime) const {
+glm::vec3 AnimationNode::interpolateScaling(float animationTime, int& cursor) const {
     if (scales.size() == 1)
         return scales[0].scale;
     
-    int p0Index = getScaleIndex(animationTime);
+    int p0Index = getScaleIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     if (p1Index >= scales.size())
         p1Index = p0Index;
@@ -151,74 +400,379 @@ glm::vec3 AnimationNode::interpolateScaling(float animationTime) const {
     return finalScale;
 }
 
-Animator::Animator() : currentAnimation(nullptr), currentTime(0.0f) {
-    finalBoneMatrices.resize(100, glm::mat4(1.0f));
+int Skeleton::find(const std::string& name) const {
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name)
+            return static_cast<int>(i);
+    }
+    return -1;
 }
 
-void Animator::updateAnimation(float dt) {
-    if (!currentAnimation)
-        return;
-    
-    currentTime += dt * currentAnimation->getTicksPerSecond();
-    if (currentTime > currentAnimation->getDuration())
-        currentTime = fmod(currentTime, currentAnimation->getDuration());
-    
-    // Clear previous transformations
-    boneTransforms.clear();
+namespace {
+
+void flattenNode(const aiNode* node, int parent, const std::map<std::string, BoneInfo>& bones, Skeleton& skeleton) {
+    std::string nodeName = node->mName.C_Str();
+    int index = static_cast<int>(skeleton.size());
+
+    auto bone = bones.find(nodeName);
+    skeleton.names.push_back(nodeName);
+    skeleton.parents.push_back(parent);
+    skeleton.boneIds.push_back(bone != bones.end() ? bone->second.id : -1);
+    skeleton.offsets.push_back(toAffine(bone != bones.end() ? bone->second.offset : glm::mat4(1.0f)));
     
-    // Calculate local transformations for each node
-    for (const auto& nodePair : currentAnimation->getAnimationNodes()) {
-        const AnimationNode& node = nodePair.second;
-        glm::mat4 nodeTransform = node.getLocalTransform(currentTime);
-        boneTransforms[node.name] = nodeTransform;
+    // Depth-first pre-order keeps every parent ahead of its children
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        flattenNode(node->mChildren[i], index, bones, skeleton);
     }
-    
-    // Calculate global transformations starting from root
-    calculateBoneTransform("RootNode", glm::mat4(1.0f));
 }
 
-void Animator::playAnimation(const Animation* animation) {
-    currentAnimation = animation;
-    currentTime = 0.0f;
+bool endsWith(const std::string& name, const std::string& suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
-void Animator::setBoneMapping(const std::string& boneName, int boneId, const glm::mat4& offset) {
-    boneIdMap[boneName] = boneId;
-    boneOffsets[boneName] = offset;
 }
 
-void Animator::buildNodeHierarchy(const aiNode* node, const glm::mat4& parentTransform) {
-    std::string nodeName = node->mName.C_Str();
-    
-    // Store parent-child relationships
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        std::string childName = node->mChildren[i]->mName.C_Str();
-        nodeHierarchy[nodeName].push_back(childName);
+Skeleton buildSkeleton(const aiNode* root, const std::map<std::string, BoneInfo>& bones) {
+    Skeleton flattened;
+    if (root)
+        flattenNode(root, -1, bones, flattened);
+
+    // Everything below the hands and the head is fingers and face
+    std::vector<bool> detail(flattened.size(), false);
+    for (size_t node = 0; node < flattened.size(); node++) {
+        int parent = flattened.parents[node];
+        if (parent >= 0)
+            detail[node] = detail[parent] || endsWith(flattened.names[parent], "Hand") || endsWith(flattened.names[parent], "Head");
     }
-    
-    // Process children
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        buildNodeHierarchy(node->mChildren[i], parentTransform);
+
+    // Detail nodes move to the end, each group keeping its order, so parents still come first
+    std::vector<size_t> order;
+    for (size_t node = 0; node < flattened.size(); node++) {
+        if (!detail[node])
+            order.push_back(node);
     }
+    size_t coreCount = order.size();
+    for (size_t node = 0; node < flattened.size(); node++) {
+        if (detail[node])
+            order.push_back(node);
+    }
+
+    std::vector<int> newIndex(flattened.size());
+    for (size_t i = 0; i < order.size(); i++)
+        newIndex[order[i]] = static_cast<int>(i);
+
+    Skeleton skeleton;
+    skeleton.coreCount = coreCount;
+    for (const auto& bone : bones)
+        skeleton.boneCount = std::max(skeleton.boneCount, static_cast<size_t>(bone.second.id + 1));
+    for (size_t node : order) {
+        int parent = flattened.parents[node];
+        skeleton.names.push_back(flattened.names[node]);
+        skeleton.parents.push_back(parent >= 0 ? newIndex[parent] : -1);
+        skeleton.boneIds.push_back(flattened.boneIds[node]);
+        skeleton.offsets.push_back(flattened.offsets[node]);
+    }
+    return skeleton;
 }
 
-void Animator::calculateBoneTransform(const std::string& nodeName, const glm::mat4& parentTransform) {
-    glm::mat4 nodeTransform = boneTransforms.count(nodeName) ? boneTransforms[nodeName] : glm::mat4(1.0f);
-    glm::mat4 globalTransform = parentTransform * nodeTransform;
-    
-    // Apply transformation if this is a bone
-    if (boneIdMap.find(nodeName) != boneIdMap.end()) {
-        int boneId = boneIdMap[nodeName];
-        if (boneId >= 0 && boneId < finalBoneMatrices.size()) {
-            finalBoneMatrices[boneId] = globalTransform * boneOffsets[nodeName];
+BoneMask buildBoneMask(const Skeleton& skeleton, const std::string& branchRoot) {
+    BoneMask mask(skeleton.size(), 0.0f);
+    int root = skeleton.find(branchRoot);
+    if (root < 0) {
+        std::cerr << "Bone mask root " << branchRoot << " is not in the skeleton" << std::endl;
+        return mask;
+    }
+
+    // Parents come before their children, so one pass from the root finds the whole branch
+    mask[root] = 1.0f;
+    for (size_t node = root + 1; node < skeleton.size(); node++) {
+        int parent = skeleton.parents[node];
+        if (parent >= 0 && mask[parent] > 0.0f)
+            mask[node] = 1.0f;
+    }
+    return mask;
+}
+
+Animator::Animator(std::shared_ptr<const Skeleton> skeleton) : skeleton(std::move(skeleton)) {
+    finalBoneMatrices.resize(this->skeleton->boneCount, glm::mat4(1.0f));
+    size_t nodeCount = this->skeleton->size();
+    localTransforms.resize(nodeCount);
+    globalTransforms.resize(nodeCount);
+    basePose.resize(nodeCount);
+    fadePose.resize(nodeCount);
+}
+
+glm::vec3 Animator::ClipPlayer::advance(float dt) {
+    if (!animation)
+        return glm::vec3(0.0f);
+    float previous = time;
+    time += dt * animation->getTicksPerSecond();
+    if (time > animation->getDuration())
+        time = fmod(time, animation->getDuration());
+    return animation->getRootMotion(previous, time);
+}
+
+void Animator::updateAnimation(float dt) {
+    advance(dt);
+    evaluate();
+}
+
+void Animator::advance(float dt) {
+    if (!base.animation)
+        return;
+
+    glm::vec3 baseMotion = base.advance(dt);
+
+    // The previous clip keeps playing while it fades out, and moving the character as much
+    if (fadingOut.animation) {
+        fadeElapsed += dt;
+        if (fadeElapsed >= fadeDuration) {
+            fadingOut = ClipPlayer();
+        } else {
+            float fade = fadeElapsed / fadeDuration;
+            baseMotion = glm::mix(fadingOut.advance(dt), baseMotion, fade);
         }
     }
-    
-    // Process children
-    if (nodeHierarchy.find(nodeName) != nodeHierarchy.end()) {
-        for (const auto& childName : nodeHierarchy[nodeName]) {
-            calculateBoneTransform(childName, globalTransform);
+    rootMotion += baseMotion;
+
+    for (auto& layer : layers) {
+        if (layer.weight != layer.targetWeight) {
+            float step = layer.fadeRate * dt;
+            if (step <= 0.0f || std::abs(layer.targetWeight - layer.weight) <= step)
+                layer.weight = layer.targetWeight;
+            else
+                layer.weight += layer.targetWeight > layer.weight ? step : -step;
         }
+        if (layer.clip.animation && layer.weight > 0.0f)
+            layer.clip.advance(dt);
     }
 }
 
+void Animator::evaluate() {
+    if (!base.animation)
+        return;
+
+    poseSource = nullptr;
+    size_t evaluated = evaluatedNodeCount();
+    sampleNodes(base, base.time, evaluated, basePose);
+    if (fadingOut.animation) {
+        sampleNodes(fadingOut, fadingOut.time, evaluated, fadePose);
+        blendPoses(fadePose, basePose, fadeElapsed / fadeDuration, basePose);
+    }
+
+    for (auto& layer : layers) {
+        if (!layer.clip.animation || layer.weight <= 0.0f)
+            continue;
+
+        sampleNodes(layer.clip, layer.clip.time, evaluated, layer.pose);
+        if (layer.blend == LayerBlend::Additive)
+            addPose(basePose, layer.pose, layer.reference, layer.mask, layer.weight, basePose);
+        else
+            blendPosesMasked(basePose, layer.pose, layer.mask, layer.weight, basePose);
+    }
+
+    // Parents come first, so the global pass is one sweep in index order.
+    // Nodes past the evaluated prefix keep their last local transform
+    const Skeleton& nodes = *skeleton;
+    const PoseKernels& kernels = poseKernels();
+    size_t nodeCount = nodes.size();
+    kernels.composeLocal(basePose.translations.data(), basePose.rotations.data(), basePose.scales.data(),
+                         localTransforms.data(), evaluated);
+    kernels.localToGlobal(localTransforms.data(), nodes.parents.data(), globalTransforms.data(), nodeCount);
+    kernels.skinningMatrices(globalTransforms.data(), nodes.offsets.data(), nodes.boneIds.data(), nodeCount,
+                             finalBoneMatrices.data(), finalBoneMatrices.size());
+    if (skinningMode == SkinningMode::DualQuaternion)
+        dualQuaternionPalette(finalBoneMatrices.data(), finalBoneMatrices.size(), boneDualQuaternions.data());
+    if (evaluated == nodeCount)
+        detailPosed = true;
+}
+
+void Animator::poseKey(float timeStep, std::vector<uint64_t>& key) const {
+    auto step = [timeStep](const ClipPlayer& player) {
+        float seconds = player.time / std::max(player.animation->getTicksPerSecond(), 1e-6f);
+        return static_cast<uint64_t>(std::llround(seconds / timeStep));
+    };
+    auto pointer = [](const void* address) { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)); };
+
+    key.clear();
+    key.push_back(pointer(skeleton.get()));
+    key.push_back((static_cast<uint64_t>(skinningMode) << 1) | (evaluatedNodeCount() == skeleton->size()));
+    key.push_back(pointer(base.animation));
+    if (!base.animation)
+        return;
+    key.push_back(step(base));
+    if (fadingOut.animation) {
+        key.push_back(pointer(fadingOut.animation));
+        key.push_back(step(fadingOut));
+        key.push_back(static_cast<uint64_t>(std::lround(fadeElapsed / fadeDuration * 64.0f)));
+    }
+
+    // Layers that contribute nothing this frame do not split the key
+    for (size_t i = 0; i < layers.size(); i++) {
+        const Layer& layer = layers[i];
+        if (!layer.clip.animation || layer.weight <= 0.0f)
+            continue;
+        // Masks are per animator copies, so they are told apart by their weights
+        uint64_t maskHash = 14695981039346656037ull;
+        for (float maskWeight : layer.mask) {
+            uint32_t bits;
+            std::memcpy(&bits, &maskWeight, sizeof(bits));
+            maskHash = (maskHash ^ bits) * 1099511628211ull;
+        }
+        key.push_back(i);
+        key.push_back(static_cast<uint64_t>(layer.blend));
+        key.push_back(maskHash);
+        key.push_back(pointer(layer.clip.animation));
+        key.push_back(step(layer.clip));
+        key.push_back(static_cast<uint64_t>(std::lround(layer.weight * 64.0f)));
+    }
+}
+
+glm::vec3 Animator::takeRootMotion() {
+    glm::vec3 motion = rootMotion;
+    rootMotion = glm::vec3(0.0f);
+    return motion;
+}
+
+void Animator::sharePose(const Animator* source) {
+    poseSource = source != this ? source : nullptr;
+}
+
+void Animator::detachPose() {
+    if (!poseSource)
+        return;
+    finalBoneMatrices = poseSource->getFinalBoneMatrices();
+    if (skinningMode == SkinningMode::DualQuaternion)
+        boneDualQuaternions = poseSource->getBoneDualQuaternions();
+    poseSource = nullptr;
+}
+
+void Animator::setSkinningMode(SkinningMode mode) {
+    skinningMode = mode;
+    if (mode == SkinningMode::DualQuaternion) {
+        boneDualQuaternions.resize(finalBoneMatrices.size() * 2);
+        dualQuaternionPalette(finalBoneMatrices.data(), finalBoneMatrices.size(), boneDualQuaternions.data());
+    } else {
+        boneDualQuaternions.clear();
+    }
+}
+
+void Animator::sampleNodes(const ClipPlayer& player, float time, size_t nodeCount, Pose& nodes) {
+    // Nodes without a track keep an identity local transform
+    nodes.resize(nodeCount);
+    nodes.setIdentity();
+    player.animation->samplePose(time, trackPose);
+
+    const std::vector<int>& channels = *player.channels;
+    for (size_t track = 0; track < channels.size(); track++) {
+        int node = channels[track];
+        if (node < 0 || static_cast<size_t>(node) >= nodeCount)
+            continue;
+        nodes.translations[node] = trackPose.translations[track];
+        nodes.rotations[node] = trackPose.rotations[track];
+        nodes.scales[node] = trackPose.scales[track];
+    }
+}
+
+void Animator::bindPlayer(ClipPlayer& player, const Animation* animation) {
+    player.animation = animation;
+    player.time = 0.0f;
+    player.channels = animation ? &bindChannels(animation) : nullptr;
+}
+
+void Animator::playAnimation(const Animation* animation) {
+    bindPlayer(base, animation);
+    fadingOut = ClipPlayer();
+}
+
+void Animator::crossfade(const Animation* animation, float duration) {
+    if (animation == base.animation)
+        return;
+    if (!base.animation || !animation || duration <= 0.0f) {
+        playAnimation(animation);
+        return;
+    }
+
+    // A fade still running is cut short, and the clip it was heading to fades out instead
+    fadingOut = base;
+    fadeElapsed = 0.0f;
+    fadeDuration = duration;
+    bindPlayer(base, animation);
+}
+
+size_t Animator::addLayer(LayerBlend blend, BoneMask mask) {
+    Layer layer;
+    layer.blend = blend;
+    layer.mask = std::move(mask);
+    layer.pose.resize(skeleton->size());
+    layer.reference.resize(skeleton->size());
+    layers.push_back(std::move(layer));
+    return layers.size() - 1;
+}
+
+void Animator::setLayerAnimation(size_t layer, const Animation* animation) {
+    Layer& target = layers.at(layer);
+    if (target.clip.animation == animation)
+        return;
+
+    bindPlayer(target.clip, animation);
+    if (animation && target.blend == LayerBlend::Additive)
+        sampleNodes(target.clip, 0.0f, skeleton->size(), target.reference);
+}
+
+void Animator::setLayerWeight(size_t layer, float weight, float fadeTime) {
+    Layer& target = layers.at(layer);
+    weight = glm::clamp(weight, 0.0f, 1.0f);
+    // Called every frame with the same target, a running fade keeps its rate
+    if (weight == target.targetWeight && fadeTime > 0.0f)
+        return;
+
+    target.targetWeight = weight;
+    if (fadeTime <= 0.0f) {
+        target.weight = target.targetWeight;
+        target.fadeRate = 0.0f;
+    } else {
+        target.fadeRate = std::abs(target.targetWeight - target.weight) / fadeTime;
+    }
+}
+
+void Animator::rebindAnimation(const Animation* animation) {
+    if (channelBindings.erase(animation) == 0)
+        return;
+
+    auto rebind = [this, animation](ClipPlayer& player) {
+        if (player.animation != animation)
+            return false;
+        player.channels = &bindChannels(animation);
+        if (player.time > animation->getDuration())
+            player.time = 0.0f;
+        return true;
+    };
+    rebind(base);
+    rebind(fadingOut);
+    for (auto& layer : layers) {
+        if (rebind(layer.clip) && layer.blend == LayerBlend::Additive)
+            sampleNodes(layer.clip, 0.0f, skeleton->size(), layer.reference);
+    }
+}
+
+const std::vector<int>& Animator::bindChannels(const Animation* animation) {
+    auto it = channelBindings.find(animation);
+    if (it != channelBindings.end())
+        return it->second;
+
+    std::vector<int>& channels = channelBindings[animation];
+    size_t unmatched = 0;
+    for (const auto& trackName : animation->getTrackNames()) {
+        channels.push_back(skeleton->find(trackName));
+        if (channels.back() < 0)
+            unmatched++;
+    }
+
+    // A clip authored for another rig still plays, minus the bones it does not share
+    if (unmatched > 0) {
+        std::cerr << "Clip " << animation->getName() << ": " << unmatched << " of " << channels.size()
+                  << " tracks match no node of the skeleton" << std::endl;
+    }
+    return channels;
+}
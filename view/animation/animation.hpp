@@ -2,11 +2,16 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include "pose.hpp"
+#include "clip_compressor.hpp"
+#include "pose_kernels.hpp"
 
 struct BoneInfo {
     int id;
@@ -43,6 +48,15 @@ struct KeyScale {
     float timeStamp;
 };
 
+// Last key used per track, so a sweep through the keys in time order
+// resumes its search where the previous sample stopped
+struct KeyframeCursor {
+    int position = 0;
+    int rotation = 0;
+    int scale = 0;
+};
+
+// Keys of one node as imported, only kept until the clip is resampled
 struct AnimationNode {
     std::vector<KeyPosition> positions;
     std::vector<KeyRotation> rotations;
@@ -51,15 +65,23 @@ struct AnimationNode {
     int boneId;
 
     glm::mat4 getLocalTransform(float animationTime) const;
-    int getPositionIndex(float animationTime) const;
-    int getRotationIndex(float animationTime) const;
-    int getScaleIndex(float animationTime) const;
+    glm::mat4 getLocalTransform(float animationTime, KeyframeCursor& cursor) const;
+    int getPositionIndex(float animationTime, int& cursor) const;
+    int getRotationIndex(float animationTime, int& cursor) const;
+    int getScaleIndex(float animationTime, int& cursor) const;
     float getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const;
-    glm::vec3 interpolatePosition(float animationTime) const;
-    glm::quat interpolateRotation(float animationTime) const;
-    glm::vec3 interpolateScaling(float animationTime) const;
+    glm::vec3 interpolatePosition(float animationTime, int& cursor) const;
+    glm::quat interpolateRotation(float animationTime, int& cursor) const;
+    glm::vec3 interpolateScaling(float animationTime, int& cursor) const;
 };
 
+// Offline check: key search time of the import resampling over every clip
+// in the directory, with the key cursors and with the linear scan they replaced
+bool profileKeyframeSearch(const std::string& clipDirectory);
+
+// Clip resampled at import to a fixed rate, then compressed within the
+// default ClipCompressionSettings tolerances. Animated channels are stored
+// frame-major, so a pose is still two contiguous rows blended element by element
 class Animation {
 public:
     Animation() = default;
@@ -67,47 +89,194 @@ public:
     
     float getDuration() const { return duration; }
     float getTicksPerSecond() const { return ticksPerSecond; }
-    const std::map<std::string, AnimationNode>& getAnimationNodes() const { return animationNodes; }
     const std::string& getName() const { return name; }
 
+    // Node names of the tracks, in the order sampling writes them
+    const std::vector<std::string>& getTrackNames() const { return trackNames; }
+    size_t getTrackCount() const { return trackNames.size(); }
+    size_t getFrameCount() const { return clip.frameCount; }
+    size_t memoryBytes() const;
+
+    // Local transform of every track at animationTime (in ticks)
+    void samplePose(float animationTime, Pose& pose) const;
+
+    // Horizontal travel of the hips between two times in ticks, in the hips'
+    // parent space. A to earlier than from has looped past the end
+    bool hasRootMotion() const { return !rootMotion.empty(); }
+    glm::vec3 getRootMotion(float fromTime, float toTime) const;
+
+    // Keys of one imported channel, before resampling
+    static AnimationNode processAnimationNode(const aiNodeAnim* nodeAnim);
+
 private:
     void processAnimation(const aiAnimation* animation);
-    void processAnimationNode(const aiNodeAnim* nodeAnim);
+    void resample(const std::vector<AnimationNode>& nodes);
+    // Moves the hips' horizontal travel out of the pose into rootMotion
+    void extractRootMotion(RawClip& raw);
+    glm::vec3 rootOffset(float animationTime) const;
 
     std::string name;
     float duration = 0.0f;
     float ticksPerSecond = 0.0f;
-    std::map<std::string, AnimationNode> animationNodes;
+
+    std::vector<std::string> trackNames;
+    float frameTicks = 1.0f;
+    CompressedClip clip;
+    // Per resampled frame, hips travel since the first; empty for clips in place
+    std::vector<glm::vec3> rootMotion;
 };
 
+// Node hierarchy flattened at load. Parents always come before their
+// children, so global transforms are one pass in index order. Finger and
+// face nodes are placed last, from coreCount on, so distant characters
+// can evaluate a prefix of the skeleton
+struct Skeleton {
+    std::vector<std::string> names;
+    std::vector<int> parents;          // -1 for the root
+    std::vector<int> boneIds;          // palette slot, -1 for plain nodes
+    std::vector<Affine3x4> offsets;    // inverse bind pose of bones
+    size_t coreCount = 0;
+    size_t boneCount = 0;              // palette slots, one per skinned bone
+
+    size_t size() const { return names.size(); }
+    int find(const std::string& name) const;
+};
+
+// Flattens the hierarchy below root, assigning each named bone its palette slot and offset.
+// The palette has a slot for every bone of the map, however many there are
+Skeleton buildSkeleton(const aiNode* root, const std::map<std::string, BoneInfo>& bones);
+
+// Weights 1 for branchRoot and every node below it, 0 elsewhere
+BoneMask buildBoneMask(const Skeleton& skeleton, const std::string& branchRoot);
+
+enum class LayerBlend {
+    Override,   // replaces the layers below, by weight
+    Additive    // adds the clip's motion relative to its first frame
+};
+
+// How the vertex shader blends a vertex's bones: a weighted sum of matrices,
+// or of dual quaternions, half the data per bone and no collapse on twists
+enum class SkinningMode {
+    Linear,
+    DualQuaternion
+};
+
+// Plays clips on one instance of a skeleton. The skeleton is shared, so
+// any number of animators can pose the same character mesh.
+// The base layer crossfades between clips; layers added on top are blended
+// over it in order, each restricted to the nodes of its mask
 class Animator {
 public:
-    Animator();
+    explicit Animator(std::shared_ptr<const Skeleton> skeleton);
+    // advance() then evaluate()
     void updateAnimation(float dt);
+    // Moves the clocks and fades only; cheap, no pose is computed
+    void advance(float dt);
+    // Samples and blends the clips at their current times into the palette
+    void evaluate();
+    // Clips from other files bind to this skeleton by node name
     void playAnimation(const Animation* animation);
-    void calculateBoneTransform(const std::string& nodeName, const glm::mat4& parentTransform);
-    const std::vector<glm::mat4>& getFinalBoneMatrices() const { return finalBoneMatrices; }
-    bool isPlaying() const { return currentAnimation != nullptr; }
-    const Animation* getCurrentAnimation() const { return currentAnimation; }
-    float getCurrentTime() const { return currentTime; }
-    
-    // Bone mapping configuration
-    void setBoneMapping(const std::string& boneName, int boneId, const glm::mat4& offset);
-    
-    // Node hierarchy building
-    void buildNodeHierarchy(const aiNode* node, const glm::mat4& parentTransform);
+    // Blends from the current base clip to animation over duration seconds
+    void crossfade(const Animation* animation, float duration);
+
+    // Returns the index of the new layer, evaluated after those added before it
+    size_t addLayer(LayerBlend blend, BoneMask mask = BoneMask());
+    // Restarts the layer on animation; playing the same clip again keeps its time
+    void setLayerAnimation(size_t layer, const Animation* animation);
+    // Moves the layer weight to weight over fadeTime seconds
+    void setLayerWeight(size_t layer, float weight, float fadeTime = 0.0f);
+    // The clip was replaced in place: its tracks are bound again, and players
+    // past its new end restart
+    void rebindAnimation(const Animation* animation);
+
+    // Without detail bones only the core prefix of the skeleton is sampled;
+    // fingers and face hold the pose they had when detail was turned off
+    void setDetailBones(bool enabled) { detailBones = enabled; }
+    // Detail is evaluated at least once, so held bones never start collapsed
+    size_t evaluatedNodeCount() const { return detailBones || !detailPosed ? skeleton->size() : skeleton->coreCount; }
+
+    // Animators with equal keys would evaluate to the same pose give or take
+    // timeStep seconds: same skeleton and skinning mode, same clips playing,
+    // times rounded to timeStep and fade and layer weights to 1/64, layers
+    // with the same blend mode and mask
+    void poseKey(float timeStep, std::vector<uint64_t>& key) const;
+    // Draws with source's palette instead of evaluating, until the next evaluate()
+    void sharePose(const Animator* source);
+    // Takes a copy of the shared palette, so the source can change or go away
+    void detachPose();
+    const Animator* getPoseSource() const { return poseSource; }
+
+    // Root motion of the base clips since the last call, blended like their poses
+    glm::vec3 takeRootMotion();
+    // Whether the clip fading in or the one fading out moves the character
+    bool hasRootMotion() const {
+        return (base.animation && base.animation->hasRootMotion())
+            || (fadingOut.animation && fadingOut.animation->hasRootMotion());
+    }
+
+    // Dual quaternion skinning also fills two vec4 per palette slot each update
+    void setSkinningMode(SkinningMode mode);
+    SkinningMode getSkinningMode() const { return skinningMode; }
+
+    const std::vector<glm::mat4>& getFinalBoneMatrices() const {
+        return poseSource ? poseSource->getFinalBoneMatrices() : finalBoneMatrices;
+    }
+    const std::vector<glm::vec4>& getBoneDualQuaternions() const {
+        return poseSource ? poseSource->getBoneDualQuaternions() : boneDualQuaternions;
+    }
+    bool isPlaying() const { return base.animation != nullptr; }
+    const Animation* getCurrentAnimation() const { return base.animation; }
+    float getCurrentTime() const { return base.time; }
+    const Skeleton& getSkeleton() const { return *skeleton; }
 
 private:
+    struct ClipPlayer {
+        const Animation* animation = nullptr;
+        const std::vector<int>* channels = nullptr;
+        float time = 0.0f;
+
+        // Returns the root motion covered
+        glm::vec3 advance(float dt);
+    };
+
+    struct Layer {
+        ClipPlayer clip;
+        LayerBlend blend;
+        BoneMask mask;
+        float weight = 0.0f;
+        float targetWeight = 0.0f;
+        float fadeRate = 0.0f;   // weight per second
+        Pose pose;
+        Pose reference;          // first frame, for additive layers
+    };
+
+    const std::vector<int>& bindChannels(const Animation* animation);
+    void bindPlayer(ClipPlayer& player, const Animation* animation);
+    // Samples the clip's tracks into a pose over the first nodeCount skeleton nodes
+    void sampleNodes(const ClipPlayer& player, float time, size_t nodeCount, Pose& nodes);
+
     std::vector<glm::mat4> finalBoneMatrices;
-    const Animation* currentAnimation;
-    float currentTime;
-    std::map<std::string, glm::mat4> boneTransforms;
-    
-    // Bone mapping structures
-    std::map<std::string, int> boneIdMap;
-    std::map<std::string, glm::mat4> boneOffsets;
-    
-    // Node hierarchy
-    std::map<std::string, std::vector<std::string>> nodeHierarchy;
-};
+    std::vector<glm::vec4> boneDualQuaternions;
+    SkinningMode skinningMode = SkinningMode::Linear;
+    std::shared_ptr<const Skeleton> skeleton;
+
+    ClipPlayer base;
+    ClipPlayer fadingOut;
+    float fadeElapsed = 0.0f;
+    float fadeDuration = 0.0f;
+    std::vector<Layer> layers;
+    bool detailBones = true;
+    bool detailPosed = false;
+    const Animator* poseSource = nullptr;
+    glm::vec3 rootMotion{0.0f};
 
+    // Skeleton node driven by each track, per clip played; -1 for tracks of unknown nodes
+    std::map<const Animation*, std::vector<int>> channelBindings;
+
+    // Per-frame scratch, sized once
+    Pose trackPose;                           // per track of the clip being sampled
+    Pose basePose;                            // per node, the blended result
+    Pose fadePose;                            // per node, the clip fading out
+    std::vector<Affine3x4> localTransforms;   // per node
+    std::vector<Affine3x4> globalTransforms;  // per node
+};
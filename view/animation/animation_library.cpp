@@ -0,0 +1,95 @@
+#include "animation_library.hpp"
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+std::string resolvePath(const std::string& path) {
+    std::error_code error;
+    std::string resolved = std::filesystem::weakly_canonical(path, error).string();
+    return error ? path : resolved;
+}
+
+}
+
+AnimationLibrary& AnimationLibrary::instance() {
+    static AnimationLibrary library;
+    return library;
+}
+
+std::shared_ptr<const Animation> AnimationLibrary::load(const std::string& path) {
+    std::string resolved = resolvePath(path);
+    auto it = clips.find(resolved);
+    if (it != clips.end())
+        return it->second.animation;
+
+    auto animation = import(path);
+    if (!animation)
+        return nullptr;
+
+    std::string name = std::filesystem::path(path).stem().string();
+    std::cout << "Loaded clip " << name << ": " << animation->getTrackCount() << " tracks, "
+              << animation->memoryBytes() / 1024 << " KB" << std::endl;
+
+    clips[resolved] = {name, animation};
+    return animation;
+}
+
+std::shared_ptr<Animation> AnimationLibrary::import(const std::string& path) {
+    // Clip files carry a full copy of the character; only the node tree and channels are kept
+    Assimp::Importer importer;
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_MATERIALS, false);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_TEXTURES, false);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_CAMERAS, false);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_LIGHTS, false);
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
+        aiComponent_MESHES | aiComponent_MATERIALS | aiComponent_TEXTURES |
+        aiComponent_CAMERAS | aiComponent_LIGHTS);
+    const aiScene* scene = importer.ReadFile(path, aiProcess_RemoveComponent);
+
+    if (!scene || !scene->HasAnimations()) {
+        std::cerr << "No animation in " << path << ": " << importer.GetErrorString() << std::endl;
+        return nullptr;
+    }
+    return std::make_shared<Animation>(scene, "");
+}
+
+bool AnimationLibrary::contains(const std::string& path) const {
+    return clips.count(resolvePath(path)) > 0;
+}
+
+const Animation* AnimationLibrary::replace(const std::string& path, Animation&& animation) {
+    auto it = clips.find(resolvePath(path));
+    if (it == clips.end())
+        return nullptr;
+
+    *it->second.animation = std::move(animation);
+    return it->second.animation.get();
+}
+
+size_t AnimationLibrary::loadDirectory(const std::string& directory) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".fbx" || extension == ".FBX"))
+            load(entry.path().string());
+    }
+    if (error)
+        std::cerr << "Cannot list clips in " << directory << ": " << error.message() << std::endl;
+    return clips.size();
+}
+
+std::shared_ptr<const Animation> AnimationLibrary::find(const std::string& name) const {
+    for (const auto& entry : clips) {
+        if (entry.second.name == name)
+            return entry.second.animation;
+    }
+    return nullptr;
+}
+
+size_t AnimationLibrary::memoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : clips)
+        bytes += entry.second.animation->memoryBytes();
+    return bytes;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include "animation.hpp"
+
+// Process-wide store of clips imported without their meshes. A clip file
+// is read once whatever the number of characters playing it, and binds to
+// a skeleton by node name when an Animator plays it
+class AnimationLibrary {
+public:
+    static AnimationLibrary& instance();
+
+    // Imports the first clip of the file, or returns the one already loaded. Null on failure
+    std::shared_ptr<const Animation> load(const std::string& path);
+
+    // Loads every clip file of a directory, returning how many are now available
+    size_t loadDirectory(const std::string& directory);
+
+    // Clip loaded from a file of that stem, e.g. "everyday_idle"
+    std::shared_ptr<const Animation> find(const std::string& name) const;
+
+    bool contains(const std::string& path) const;
+    // Reads the first clip of the file without caching it, on any thread. Null on failure
+    static std::shared_ptr<Animation> import(const std::string& path);
+    // Swaps a re-imported clip into the loaded one in place, so every holder
+    // sees the new keys. Returns the clip replaced, null if none was loaded.
+    // Animators playing it must be rebound before their next update
+    const Animation* replace(const std::string& path, Animation&& animation);
+
+    void clear() { clips.clear(); }
+    size_t clipCount() const { return clips.size(); }
+    size_t memoryBytes() const;
+
+private:
+    AnimationLibrary() = default;
+
+    struct LoadedClip {
+        std::string name;
+        std::shared_ptr<Animation> animation;
+    };
+
+    std::unordered_map<std::string, LoadedClip> clips;   // by resolved path
+};
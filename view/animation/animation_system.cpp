@@ -0,0 +1,324 @@
+#include "animation_system.hpp"
+#include "animation_library.hpp"
+#include "character_animation.hpp"
+#include "../model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+// Animators per job pickup, small enough to even out uneven skeletons
+const size_t BATCH_SIZE = 4;
+
+// Nearest first; the last level covers everything beyond
+const AnimationLod LOD_LEVELS[] = {
+    {10.0f, 1, true},
+    {25.0f, 2, false},
+    {50.0f, 4, false},
+    {0.0f, 8, false},
+};
+const size_t LOD_LEVEL_COUNT = sizeof(LOD_LEVELS) / sizeof(LOD_LEVELS[0]);
+
+// Animators whose clips are within this many seconds of each other share a pose
+const float POSE_SHARE_STEP = 1.0f / 60.0f;
+
+}
+
+AnimationSystem& AnimationSystem::instance() {
+    static AnimationSystem system;
+    return system;
+}
+
+AnimationSystem::AnimationSystem() {
+    // Leave one core to the main thread, which helps in finish()
+    unsigned int cores = std::thread::hardware_concurrency();
+    setWorkerCount(cores > 1 ? cores - 1 : 0);
+}
+
+void AnimationSystem::add(Animator* animator) {
+    finish();
+    Entry entry;
+    entry.animator = animator;
+    entry.phase = nextPhase++;
+    animators.push_back(entry);
+}
+
+void AnimationSystem::remove(Animator* animator) {
+    finish();
+    for (auto& entry : animators) {
+        if (entry.animator->getPoseSource() == animator)
+            entry.animator->detachPose();
+    }
+    animators.erase(std::remove_if(animators.begin(), animators.end(),
+        [animator](const Entry& entry) { return entry.animator == animator; }), animators.end());
+}
+
+void AnimationSystem::rebindAnimation(const Animation* animation) {
+    finish();
+    for (auto& entry : animators)
+        entry.animator->rebindAnimation(animation);
+}
+
+void AnimationSystem::setPosition(const Animator* animator, const glm::vec3& position) {
+    for (auto& entry : animators) {
+        if (entry.animator == animator) {
+            entry.position = position;
+            return;
+        }
+    }
+}
+
+const AnimationLod& AnimationSystem::lodFor(const Entry& entry) const {
+    if (!lodEnabled)
+        return LOD_LEVELS[0];
+    float distance = glm::length(entry.position - viewPosition);
+    for (size_t level = 0; level + 1 < LOD_LEVEL_COUNT; level++) {
+        if (distance < LOD_LEVELS[level].maxDistance)
+            return LOD_LEVELS[level];
+    }
+    return LOD_LEVELS[LOD_LEVEL_COUNT - 1];
+}
+
+void AnimationSystem::setWorkerCount(unsigned int count) {
+    finish();
+    workers.reset();
+    if (count > 0)
+        workers = std::make_unique<ThreadPool>(count);
+}
+
+void AnimationSystem::begin(float dt) {
+    finish();
+    frameStart = std::chrono::steady_clock::now();
+    frameIndex++;
+
+    // Animators not due this frame keep last frame's palette and bank the time.
+    // One borrowing another's pose takes a copy first, as the lender moves on
+    pendingStats = AnimationFrameStats();
+    pendingStats.animators = animators.size();
+    for (auto& entry : animators) {
+        const AnimationLod& lod = lodFor(entry);
+        entry.pendingDelta += dt;
+        entry.due = (frameIndex + entry.phase) % lod.interval == 0;
+        if (entry.due) {
+            entry.animator->setDetailBones(lod.detailBones);
+        } else {
+            entry.animator->detachPose();
+            pendingStats.nodesSkipped += entry.animator->getSkeleton().size();
+        }
+    }
+
+    // Due animators whose pose matches one already queued borrow its palette
+    due.clear();
+    sharedPoses.clear();
+    for (size_t i = 0; i < animators.size(); i++) {
+        Entry& entry = animators[i];
+        if (!entry.due)
+            continue;
+
+        Animator* animator = entry.animator;
+        animator->advance(entry.pendingDelta);
+        entry.pendingDelta = 0.0f;
+        pendingStats.updated++;
+        size_t nodeCount = animator->getSkeleton().size();
+
+        if (poseSharing && animator->isPlaying()) {
+            animator->poseKey(POSE_SHARE_STEP, entry.poseKey);
+            uint64_t hash = 14695981039346656037ull;
+            for (uint64_t word : entry.poseKey)
+                hash = (hash ^ word) * 1099511628211ull;
+
+            auto found = sharedPoses.find(hash);
+            if (found != sharedPoses.end() && animators[found->second].poseKey == entry.poseKey) {
+                animator->sharePose(animators[found->second].animator);
+                pendingStats.shared++;
+                pendingStats.nodesSkipped += nodeCount;
+                continue;
+            }
+            sharedPoses.emplace(hash, i);
+        }
+
+        due.push_back(animator);
+        size_t evaluated = animator->evaluatedNodeCount();
+        pendingStats.nodesEvaluated += evaluated;
+        pendingStats.nodesSkipped += nodeCount - evaluated;
+    }
+
+    nextAnimator = 0;
+    inFlight = true;
+
+    size_t batches = (due.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    size_t jobs = std::min<size_t>(workerCount(), batches);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobsRunning = jobs;
+    }
+    for (size_t i = 0; i < jobs; i++) {
+        workers->enqueue([this] {
+            runBatches();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobsRunning--;
+            }
+            jobsDone.notify_all();
+        });
+    }
+}
+
+void AnimationSystem::finish() {
+    if (!inFlight)
+        return;
+
+    // Batches no worker has picked up yet run here instead of waiting
+    runBatches();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobsDone.wait(lock, [this] { return jobsRunning == 0; });
+    }
+    inFlight = false;
+    stats = pendingStats;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+}
+
+void AnimationSystem::runBatches() {
+    // Each animator only touches its own buffers, so batches need no locking
+    size_t count = due.size();
+    while (true) {
+        size_t first = nextAnimator.fetch_add(BATCH_SIZE);
+        if (first >= count)
+            return;
+        size_t last = std::min(first + BATCH_SIZE, count);
+        for (size_t i = first; i < last; i++)
+            due[i]->evaluate();
+    }
+}
+
+bool profileAnimation(const std::string& modelPath, size_t characterCount) {
+    // CPU import only, no GL context is needed
+    Model model(modelPath, false);
+    if (!model.hasSkeleton()) {
+        std::cerr << "No skeleton in " << modelPath << std::endl;
+        return false;
+    }
+
+    std::string clipPrefix = std::filesystem::path(modelPath).parent_path().string() + "/animations/"
+                           + std::filesystem::path(modelPath).stem().string() + "_";
+    const Locomotion states[] = {Locomotion::Idle, Locomotion::Walk, Locomotion::Run, Locomotion::Crouch, Locomotion::CrouchWalk};
+
+    std::vector<std::unique_ptr<CharacterAnimation>> characters;
+    for (size_t i = 0; i < characterCount; i++) {
+        characters.push_back(std::make_unique<CharacterAnimation>(model.createAnimator(), clipPrefix));
+        characters.back()->update(states[i % 5], MoveDirection::Forward, i % 3 == 0);
+    }
+
+    // Pose to palette alone, the plain glm path against the vectorized kernels
+    const Skeleton& skeleton = *model.getSkeleton();
+    Pose pose;
+    pose.resize(skeleton.size());
+    pose.setIdentity();
+    std::vector<Affine3x4> local(skeleton.size()), global(skeleton.size());
+    std::vector<glm::mat4> palette(skeleton.boneCount);
+    for (const PoseKernels* kernels : supportedPoseKernels()) {
+        const int iterations = 10000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            kernels->composeLocal(pose.translations.data(), pose.rotations.data(), pose.scales.data(), local.data(), local.size());
+            kernels->localToGlobal(local.data(), skeleton.parents.data(), global.data(), global.size());
+            kernels->skinningMatrices(global.data(), skeleton.offsets.data(), skeleton.boneIds.data(), global.size(),
+                                      palette.data(), palette.size());
+        }
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Pose to palette with " << kernels->name << (kernels == &poseKernels() ? " (selected)" : "")
+                  << ": " << microseconds / iterations << " us per character" << std::endl;
+    }
+
+    // Clip decode alone, a pose per resampled frame of each of the character's clips
+    std::filesystem::path clipDirectory = std::filesystem::path(clipPrefix).parent_path();
+    std::string clipStem = std::filesystem::path(modelPath).stem().string() + "_";
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(clipDirectory, error)) {
+        if (file.path().extension() != ".fbx" || file.path().filename().string().rfind(clipStem, 0) != 0)
+            continue;
+        auto clip = AnimationLibrary::instance().load(file.path().string());
+        if (!clip || clip->getFrameCount() == 0)
+            continue;
+
+        size_t frameCount = clip->getFrameCount();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < frameCount; frame++)
+            clip->samplePose(clip->getDuration() * (frame + 0.5f) / frameCount, pose);
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Sampling " << clip->getName() << ": " << nanoseconds / frameCount << " ns per pose" << std::endl;
+    }
+
+    AnimationSystem& system = AnimationSystem::instance();
+    unsigned int maxCores = std::max(1u, std::thread::hardware_concurrency());
+    const int frames = 200;
+    double singleCore = 0.0;
+
+    // Every character evaluates its own pose while scaling is measured
+    system.setPoseSharing(false);
+    for (unsigned int cores = 1; cores <= maxCores; cores++) {
+        system.setWorkerCount(cores - 1);
+
+        // Warm up once so fades have settled and the workers are running
+        system.begin(1.0f / 60.0f);
+        system.finish();
+
+        double total = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            system.begin(1.0f / 60.0f);
+            system.finish();
+            total += system.lastFrameMilliseconds();
+        }
+        double perFrame = total / frames;
+        if (cores == 1)
+            singleCore = perFrame;
+
+        std::cout << characterCount << " characters on " << cores << " core(s): " << perFrame
+                  << " ms per frame, " << singleCore / perFrame << "x" << std::endl;
+    }
+
+    // Spread the crowd evenly out to 80 units, then compare a frame with and without LOD,
+    // and with the characters in lockstep sharing their poses
+    for (size_t i = 0; i < characterCount; i++) {
+        float distance = 80.0f * (i + 0.5f) / characterCount;
+        float angle = i * 2.4f;
+        characters[i]->setPosition(glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * distance);
+    }
+    system.setViewPosition(glm::vec3(0.0f));
+
+    for (int mode = 0; mode < 3; mode++) {
+        bool lod = mode > 0;
+        bool sharing = mode > 1;
+        system.setLodEnabled(lod);
+        system.setPoseSharing(sharing);
+        system.begin(1.0f / 60.0f);
+        system.finish();
+
+        double total = 0.0, worst = 0.0;
+        size_t updated = 0, shared = 0, evaluated = 0, skipped = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            system.begin(1.0f / 60.0f);
+            system.finish();
+            const AnimationFrameStats& stats = system.lastFrameStats();
+            total += stats.milliseconds;
+            worst = std::max(worst, stats.milliseconds);
+            updated += stats.updated;
+            shared += stats.shared;
+            evaluated += stats.nodesEvaluated;
+            skipped += stats.nodesSkipped;
+        }
+        std::cout << "LOD " << (lod ? "on" : "off") << ", pose sharing " << (sharing ? "on" : "off") << ": "
+                  << total / frames << " ms per frame (worst " << worst << "), " << updated / frames << " of "
+                  << characterCount << " characters updated, " << shared / frames << " of them sharing, "
+                  << evaluated / frames << " nodes evaluated, " << skipped / frames << " held" << std::endl;
+    }
+
+    characters.clear();
+    system.setLodEnabled(true);
+    system.setPoseSharing(true);
+    system.setWorkerCount(maxCores > 1 ? maxCores - 1 : 0);
+    return true;
+}
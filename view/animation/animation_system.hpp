@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "animation.hpp"
+#include "../thread_pool.hpp"
+
+// Update rate and skeleton detail for characters up to maxDistance from the view
+struct AnimationLod {
+    float maxDistance;
+    unsigned int interval;   // updated every interval-th frame, holding the pose in between
+    bool detailBones;        // fingers and face
+};
+
+// Work done by the last completed frame
+struct AnimationFrameStats {
+    size_t animators = 0;
+    size_t updated = 0;          // animators due this frame
+    size_t shared = 0;           // due, but borrowing the pose of an identical one
+    size_t nodesEvaluated = 0;   // skeleton nodes sampled and blended
+    size_t nodesSkipped = 0;     // held by animators not due, or detail bones turned off
+    double milliseconds = 0.0;
+};
+
+// Updates every registered animator in parallel. begin() hands the frame's
+// sampling and hierarchy work to the workers and returns at once; finish()
+// takes a share of what is left and returns when every bone palette is ready.
+// Distant animators update less often and without detail bones; their frames
+// are staggered so each LOD level spreads its cost evenly. Animators playing
+// the same clips at the same time evaluate once and share the palette
+class AnimationSystem {
+public:
+    static AnimationSystem& instance();
+
+    // Animators are not owned and must be removed before they are destroyed
+    void add(Animator* animator);
+    void remove(Animator* animator);
+    // Rebinds every animator to a clip replaced in place; call before the replacement
+    // is used, after which the next begin() samples the new keys
+    void rebindAnimation(const Animation* animation);
+
+    // World positions for the distance LOD; animators never placed count as close
+    void setPosition(const Animator* animator, const glm::vec3& position);
+    void setViewPosition(const glm::vec3& position) { viewPosition = position; }
+    // Off, every animator updates every frame with all its bones
+    void setLodEnabled(bool enabled) { lodEnabled = enabled; }
+    // Off, every due animator evaluates its own pose
+    void setPoseSharing(bool enabled) { poseSharing = enabled; }
+
+    void begin(float dt);
+    void finish();
+
+    // Worker threads besides the one calling finish(); 0 runs everything there
+    void setWorkerCount(unsigned int count);
+    unsigned int workerCount() const { return workers ? workers->size() : 0; }
+    size_t animatorCount() const { return animators.size(); }
+
+    // Time from begin() to the last palette being ready, for the previous frame
+    double lastFrameMilliseconds() const { return stats.milliseconds; }
+    const AnimationFrameStats& lastFrameStats() const { return stats; }
+
+private:
+    struct Entry {
+        Animator* animator;
+        glm::vec3 position{0.0f};
+        float pendingDelta = 0.0f;   // time since the animator was last updated
+        unsigned int phase = 0;      // offsets its update frames from the others
+        bool due = false;
+        std::vector<uint64_t> poseKey;
+    };
+
+    AnimationSystem();
+    const AnimationLod& lodFor(const Entry& entry) const;
+    void runBatches();
+
+    std::vector<Entry> animators;
+    std::vector<Animator*> due;                        // evaluated this frame
+    std::unordered_map<uint64_t, size_t> sharedPoses;  // pose key hash to the entry evaluating it
+    std::unique_ptr<ThreadPool> workers;
+
+    glm::vec3 viewPosition{0.0f};
+    bool lodEnabled = true;
+    bool poseSharing = true;
+    unsigned int frameIndex = 0;
+    unsigned int nextPhase = 0;
+
+    std::atomic<size_t> nextAnimator{0};
+    size_t jobsRunning = 0;
+    bool inFlight = false;
+    std::mutex mutex;
+    std::condition_variable jobsDone;
+
+    std::chrono::steady_clock::time_point frameStart;
+    AnimationFrameStats pendingStats;
+    AnimationFrameStats stats;
+};
+
+// Offline measurement: times every supported pose kernel on the model's
+// skeleton, then animates characterCount copies of it on 1 to N cores and
+// prints the time per frame of each, and finally compares a crowd spread
+// over distance with and without LOD and pose sharing
+bool profileAnimation(const std::string& modelPath, size_t characterCount);
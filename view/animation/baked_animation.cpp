@@ -0,0 +1,235 @@
+#include "baked_animation.hpp"
+#include "animation_library.hpp"
+#include "../model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char BAKED_IDENTIFIER[8] = {'B', 'W', 'B', 'A', 'K', 'E', '1', '\n'};
+
+std::string clipPath(const std::string& modelPath, const std::string& clipName) {
+    std::filesystem::path model(modelPath);
+    return (model.parent_path() / "animations" / (model.stem().string() + "_" + clipName + ".fbx")).string();
+}
+
+}
+
+const BakedClip* BakedAnimationSet::find(const std::string& name) const {
+    for (const auto& clip : clips) {
+        if (clip.name == name)
+            return &clip;
+    }
+    return nullptr;
+}
+
+BakedAnimationSet bakeAnimations(std::shared_ptr<const Skeleton> skeleton,
+    const std::vector<std::pair<std::string, std::shared_ptr<const Animation>>>& clips,
+    float framesPerSecond) {
+    BakedAnimationSet baked;
+    baked.boneCount = static_cast<uint32_t>(skeleton->boneCount);
+
+    Animator animator(skeleton);
+
+    for (const auto& entry : clips) {
+        const Animation* animation = entry.second.get();
+        if (!animation || animation->getTicksPerSecond() <= 0.0f)
+            continue;
+
+        BakedClip clip;
+        clip.name = entry.first;
+        clip.firstRow = baked.rowCount();
+        clip.framesPerSecond = framesPerSecond;
+        float seconds = animation->getDuration() / animation->getTicksPerSecond();
+        clip.frameCount = std::max(1u, static_cast<uint32_t>(std::lround(seconds * framesPerSecond)));
+
+        animator.playAnimation(animation);
+        for (uint32_t frame = 0; frame < clip.frameCount; frame++) {
+            animator.updateAnimation(frame == 0 ? 0.0f : 1.0f / framesPerSecond);
+            const auto& palette = animator.getFinalBoneMatrices();
+            for (uint32_t bone = 0; bone < baked.boneCount; bone++) {
+                const glm::mat4& matrix = palette[bone];
+                for (int row = 0; row < 3; row++)
+                    baked.texels.push_back(glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]));
+            }
+        }
+        baked.clips.push_back(clip);
+    }
+
+    return baked;
+}
+
+bool readBakedAnimations(const std::string& path, const Skeleton& skeleton, BakedAnimationSet& baked) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    // Counts are checked against what is left of the file before anything is sized from them
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+    auto remaining = [&]() -> uint64_t {
+        std::streamoff position = file.tellg();
+        return position < 0 ? 0 : static_cast<uint64_t>(fileSize - position);
+    };
+    auto truncated = [&]() {
+        std::cerr << "Truncated baked animation file: " << path << std::endl;
+        return false;
+    };
+
+    char identifier[sizeof(BAKED_IDENTIFIER)];
+    uint32_t clipCount = 0;
+    uint32_t texelCount = 0;
+    file.read(identifier, sizeof(identifier));
+    file.read(reinterpret_cast<char*>(&baked.boneCount), sizeof(baked.boneCount));
+    file.read(reinterpret_cast<char*>(&clipCount), sizeof(clipCount));
+    if (!file || std::memcmp(identifier, BAKED_IDENTIFIER, sizeof(identifier)) != 0) {
+        std::cerr << "Not a baked animation file: " << path << std::endl;
+        return false;
+    }
+
+    // A file baked for another skeleton would index out of the texture
+    if (baked.boneCount != skeleton.boneCount || baked.boneCount == 0) {
+        std::cerr << "Baked animation file " << path << " has " << baked.boneCount << " bones, the skeleton "
+                  << skeleton.boneCount << std::endl;
+        return false;
+    }
+
+    // Name length, first row, frame count and rate
+    const uint64_t clipHeaderSize = 4 * sizeof(uint32_t);
+    if (clipCount > remaining() / clipHeaderSize)
+        return truncated();
+    baked.clips.resize(clipCount);
+    for (auto& clip : baked.clips) {
+        uint32_t nameLength = 0;
+        file.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
+        if (!file || nameLength > remaining())
+            return truncated();
+        clip.name.resize(nameLength);
+        file.read(&clip.name[0], nameLength);
+        file.read(reinterpret_cast<char*>(&clip.firstRow), sizeof(clip.firstRow));
+        file.read(reinterpret_cast<char*>(&clip.frameCount), sizeof(clip.frameCount));
+        file.read(reinterpret_cast<char*>(&clip.framesPerSecond), sizeof(clip.framesPerSecond));
+    }
+
+    file.read(reinterpret_cast<char*>(&texelCount), sizeof(texelCount));
+    if (!file || texelCount > remaining() / sizeof(glm::vec4))
+        return truncated();
+    baked.texels.resize(texelCount);
+    file.read(reinterpret_cast<char*>(baked.texels.data()), texelCount * sizeof(glm::vec4));
+    if (!file)
+        return truncated();
+
+    // Clips past the last frame would index out of the texture too
+    if (texelCount % baked.width() != 0) {
+        std::cerr << "Baked animation file " << path << " has a partial frame" << std::endl;
+        return false;
+    }
+    for (const auto& clip : baked.clips) {
+        if (clip.frameCount == 0 || clip.firstRow > baked.rowCount() ||
+            clip.frameCount > baked.rowCount() - clip.firstRow) {
+            std::cerr << "Baked animation file " << path << ": clip " << clip.name << " is out of range" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeBakedAnimations(const std::string& path, const BakedAnimationSet& baked) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot write baked animation file: " << path << std::endl;
+        return false;
+    }
+
+    uint32_t clipCount = static_cast<uint32_t>(baked.clips.size());
+    file.write(BAKED_IDENTIFIER, sizeof(BAKED_IDENTIFIER));
+    file.write(reinterpret_cast<const char*>(&baked.boneCount), sizeof(baked.boneCount));
+    file.write(reinterpret_cast<const char*>(&clipCount), sizeof(clipCount));
+
+    for (const auto& clip : baked.clips) {
+        uint32_t nameLength = static_cast<uint32_t>(clip.name.size());
+        file.write(reinterpret_cast<const char*>(&nameLength), sizeof(nameLength));
+        file.write(clip.name.data(), nameLength);
+        file.write(reinterpret_cast<const char*>(&clip.firstRow), sizeof(clip.firstRow));
+        file.write(reinterpret_cast<const char*>(&clip.frameCount), sizeof(clip.frameCount));
+        file.write(reinterpret_cast<const char*>(&clip.framesPerSecond), sizeof(clip.framesPerSecond));
+    }
+
+    uint32_t texelCount = static_cast<uint32_t>(baked.texels.size());
+    file.write(reinterpret_cast<const char*>(&texelCount), sizeof(texelCount));
+    file.write(reinterpret_cast<const char*>(baked.texels.data()), texelCount * sizeof(glm::vec4));
+    return static_cast<bool>(file);
+}
+
+std::string bakedAnimationPath(const std::string& modelPath) {
+    std::filesystem::path model(modelPath);
+    return (model.parent_path() / "animations" / (model.stem().string() + ".baked")).string();
+}
+
+bool isBakedAnimationCurrent(const std::string& modelPath, const std::vector<std::string>& clipNames) {
+    std::error_code error;
+    auto bakedTime = std::filesystem::last_write_time(bakedAnimationPath(modelPath), error);
+    if (error)
+        return false;
+
+    // A model or clip edited after baking wins over the stale bake
+    if (std::filesystem::last_write_time(modelPath, error) > bakedTime)
+        return false;
+    for (const auto& name : clipNames) {
+        if (std::filesystem::last_write_time(clipPath(modelPath, name), error) > bakedTime)
+            return false;
+    }
+    return true;
+}
+
+bool loadBakedAnimations(std::shared_ptr<const Skeleton> skeleton, const std::string& modelPath,
+    const std::vector<std::string>& clipNames, BakedAnimationSet& baked) {
+    std::string path = bakedAnimationPath(modelPath);
+    if (isBakedAnimationCurrent(modelPath, clipNames) && readBakedAnimations(path, *skeleton, baked))
+        return true;
+
+    std::cout << "Baked animations of " << modelPath << " missing or stale, baking them now" << std::endl;
+    std::vector<std::pair<std::string, std::shared_ptr<const Animation>>> clips;
+    for (const auto& name : clipNames) {
+        auto animation = AnimationLibrary::instance().load(clipPath(modelPath, name));
+        if (!animation)
+            return false;
+        clips.emplace_back(name, animation);
+    }
+    baked = bakeAnimations(skeleton, clips);
+
+    // The next start reads it back; a failed write only costs another bake
+    writeBakedAnimations(path, baked);
+    return true;
+}
+
+bool bakeCharacterAnimations(const std::string& modelPath, const std::vector<std::string>& clipNames) {
+    // CPU import only, no GL context is needed
+    Model model(modelPath, false);
+    if (!model.hasSkeleton()) {
+        std::cerr << "No skeleton in " << modelPath << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::shared_ptr<const Animation>>> clips;
+    for (const auto& name : clipNames) {
+        auto animation = AnimationLibrary::instance().load(clipPath(modelPath, name));
+        if (!animation)
+            return false;
+        clips.emplace_back(name, animation);
+    }
+
+    BakedAnimationSet baked = bakeAnimations(model.getSkeleton(), clips);
+    std::string path = bakedAnimationPath(modelPath);
+    if (!writeBakedAnimations(path, baked))
+        return false;
+
+    std::cout << "Baked " << baked.clips.size() << " clips of " << modelPath << ": " << baked.boneCount
+              << " bones x " << baked.rowCount() << " frames, "
+              << baked.texels.size() * sizeof(glm::vec4) / 1024 << " KB -> " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "animation.hpp"
+
+// One clip inside a BakedAnimationSet, frames firstRow to firstRow + frameCount - 1
+struct BakedClip {
+    std::string name;
+    uint32_t firstRow = 0;
+    uint32_t frameCount = 0;
+    float framesPerSecond = 0.0f;
+};
+
+// Bone palettes of several clips sampled at a fixed rate, laid out as a
+// texture: one row per frame, three RGBA32F texels per bone holding the
+// first three rows of its matrix
+struct BakedAnimationSet {
+    uint32_t boneCount = 0;
+    std::vector<BakedClip> clips;
+    std::vector<glm::vec4> texels;
+
+    uint32_t width() const { return boneCount * 3; }
+    uint32_t rowCount() const { return boneCount ? static_cast<uint32_t>(texels.size() / width()) : 0; }
+    const BakedClip* find(const std::string& name) const;
+};
+
+// Samples every clip on the skeleton at framesPerSecond, looping back to frame 0
+BakedAnimationSet bakeAnimations(std::shared_ptr<const Skeleton> skeleton,
+    const std::vector<std::pair<std::string, std::shared_ptr<const Animation>>>& clips,
+    float framesPerSecond = 30.0f);
+
+// Fails on files baked for a skeleton with another bone count, or with clips past the last frame
+bool readBakedAnimations(const std::string& path, const Skeleton& skeleton, BakedAnimationSet& baked);
+bool writeBakedAnimations(const std::string& path, const BakedAnimationSet& baked);
+
+// Baked file of a character: ".../yahya/everyday.fbx" -> ".../yahya/animations/everyday.baked"
+std::string bakedAnimationPath(const std::string& modelPath);
+
+// True when the baked file is newer than the model and the named clips
+bool isBakedAnimationCurrent(const std::string& modelPath, const std::vector<std::string>& clipNames);
+
+// Reads the baked file of a character, baking the named clips and writing the
+// file instead when it is missing, stale or invalid
+bool loadBakedAnimations(std::shared_ptr<const Skeleton> skeleton, const std::string& modelPath,
+    const std::vector<std::string>& clipNames, BakedAnimationSet& baked);
+
+// Offline step: bakes the named clips of a character ("idle" for
+// "everyday_idle.fbx" next to "everyday.fbx") to its baked file
+bool bakeCharacterAnimations(const std::string& modelPath, const std::vector<std::string>& clipNames);
@@ -0,0 +1,81 @@
+#include "character_animation.hpp"
+#include "animation_library.hpp"
+#include "animation_system.hpp"
+
+namespace {
+
+const float LOCOMOTION_FADE = 0.25f;   // seconds
+const float FIRE_FADE_IN = 0.1f;
+const float FIRE_FADE_OUT = 0.3f;
+
+bool isCrouched(Locomotion locomotion) {
+    return locomotion == Locomotion::Crouch || locomotion == Locomotion::CrouchWalk;
+}
+
+}
+
+CharacterAnimation::CharacterAnimation(std::unique_ptr<Animator> animator, const std::string& clipPrefix)
+    : animator(std::move(animator)), clipPrefix(clipPrefix) {
+    idle = loadClip("idle");
+    crouch = loadClip("rifle_kneel_idle");
+
+    // Forward, backward, left, right: each plays the way its root motion moves
+    const char* walkClips[] = {"rifle_walk", "backwards_rifle_walk", "rifle_walk_left", "rifle_walk_right"};
+    const char* runClips[] = {"rifle_run", "backwards_rifle_run", "left_strafe_run", "right_strafe_run"};
+    const char* crouchWalkClips[] = {"rifle_crouch_walk", "rifle_crouch_backward_walk", "crouch_walk_left", "crouch_walk_right"};
+    for (int i = 0; i < 4; i++) {
+        walk[i] = loadClip(walkClips[i]);
+        run[i] = loadClip(runClips[i]);
+        crouchWalk[i] = loadClip(crouchWalkClips[i]);
+    }
+    fire = loadClip("firing_rifle");
+    crouchedFire = loadClip("firing_rifle_crouched");
+
+    // The spine carries the arms and head, so the legs stay on the locomotion clip
+    upperBodyLayer = this->animator->addLayer(LayerBlend::Override,
+        buildBoneMask(this->animator->getSkeleton(), "mixamorig:Spine"));
+    this->animator->playAnimation(locomotionClip(locomotion, direction));
+
+    AnimationSystem::instance().add(this->animator.get());
+}
+
+CharacterAnimation::~CharacterAnimation() {
+    AnimationSystem::instance().remove(animator.get());
+}
+
+void CharacterAnimation::setPosition(const glm::vec3& position) {
+    AnimationSystem::instance().setPosition(animator.get(), position);
+}
+
+std::shared_ptr<const Animation> CharacterAnimation::loadClip(const std::string& name) {
+    return AnimationLibrary::instance().load(clipPrefix + name + ".fbx");
+}
+
+const Animation* CharacterAnimation::locomotionClip(Locomotion state, MoveDirection direction) const {
+    const std::shared_ptr<const Animation>* clips = nullptr;
+    switch (state) {
+        case Locomotion::Idle: return idle.get();
+        case Locomotion::Crouch: return crouch ? crouch.get() : idle.get();
+        case Locomotion::Walk: clips = walk; break;
+        case Locomotion::Run: clips = run; break;
+        case Locomotion::CrouchWalk: clips = crouchWalk; break;
+    }
+    // A missing direction falls back to forward, and a missing clip to standing
+    // idle rather than freezing the pose
+    const auto& clip = clips[static_cast<int>(direction)];
+    if (clip)
+        return clip.get();
+    return clips[0] ? clips[0].get() : idle.get();
+}
+
+void CharacterAnimation::update(Locomotion state, MoveDirection moveDirection, bool firing) {
+    if (state != locomotion || moveDirection != direction) {
+        locomotion = state;
+        direction = moveDirection;
+        animator->crossfade(locomotionClip(state, direction), LOCOMOTION_FADE);
+    }
+
+    const Animation* fireClip = isCrouched(state) && crouchedFire ? crouchedFire.get() : fire.get();
+    animator->setLayerAnimation(upperBodyLayer, fireClip);
+    animator->setLayerWeight(upperBodyLayer, firing ? 1.0f : 0.0f, firing ? FIRE_FADE_IN : FIRE_FADE_OUT);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <memory>
+#include "animation.hpp"
+#include "../../controller/game_controller.hpp"
+
+// Drives an Animator from the player's state. Locomotion clips, one per
+// movement direction, crossfade on the base layer, and firing plays on the upper body over whatever the legs do.
+// The animator itself is advanced with every other one by the AnimationSystem
+class CharacterAnimation {
+public:
+    // Clips are loaded through the animation library from clipPrefix + name + ".fbx"
+    CharacterAnimation(std::unique_ptr<Animator> animator, const std::string& clipPrefix);
+    ~CharacterAnimation();
+
+    CharacterAnimation(const CharacterAnimation&) = delete;
+    CharacterAnimation& operator=(const CharacterAnimation&) = delete;
+
+    // Picks the clips for this frame; call before AnimationSystem::begin()
+    void update(Locomotion state, MoveDirection direction, bool firing);
+
+    // World position, for the animation level of detail
+    void setPosition(const glm::vec3& position);
+
+    // Ground covered by the locomotion clips since the last call, in model space
+    glm::vec3 takeRootMotion() { return animator->takeRootMotion(); }
+    // False while the clips playing stay in place, and the player needs another speed
+    bool hasRootMotion() const { return animator->hasRootMotion(); }
+
+    const Animator& getAnimator() const { return *animator; }
+
+private:
+    std::shared_ptr<const Animation> loadClip(const std::string& name);
+    const Animation* locomotionClip(Locomotion state, MoveDirection direction) const;
+
+    std::unique_ptr<Animator> animator;
+    std::string clipPrefix;
+
+    std::shared_ptr<const Animation> idle, crouch;
+    std::shared_ptr<const Animation> walk[4], run[4], crouchWalk[4];   // by MoveDirection
+    std::shared_ptr<const Animation> fire, crouchedFire;
+
+    Locomotion locomotion = Locomotion::Idle;
+    MoveDirection direction = MoveDirection::Forward;
+    size_t upperBodyLayer = 0;
+};
@@ -0,0 +1,176 @@
+#include "clip_compressor.hpp"
+#include <algorithm>
+
+namespace {
+
+// Angle between two rotations. Measured through the chord rather than
+// acos(dot), which loses all precision for the tiny angles compared here
+float rotationAngle(const glm::quat& a, glm::quat b) {
+    if (glm::dot(a, b) < 0.0f)
+        b = -b;
+    glm::quat difference = a + (-b);
+    glm::quat sum = a + b;
+    return glm::degrees(4.0f * std::atan2(std::sqrt(glm::dot(difference, difference)), std::sqrt(glm::dot(sum, sum))));
+}
+
+glm::quat nlerp(const glm::quat& a, glm::quat b, float alpha) {
+    if (glm::dot(a, b) < 0.0f)
+        b = -b;
+    return glm::normalize(a * (1.0f - alpha) + b * alpha);
+}
+
+template <typename T, typename Distance>
+bool isConstant(const std::vector<T>& values, size_t trackCount, size_t frameCount, size_t track,
+                float tolerance, Distance distance) {
+    for (size_t frame = 1; frame < frameCount; frame++) {
+        if (distance(values[track], values[frame * trackCount + track]) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+}
+
+size_t CompressedClip::memoryBytes() const {
+    return restPose.size() * (sizeof(glm::vec3) * 2 + sizeof(glm::quat)) +
+           (animatedTranslations.size() + animatedRotations.size() + animatedScales.size()) * sizeof(uint16_t) +
+           (keptFrames.size() + rowOfFrame.size()) * sizeof(uint16_t) +
+           translationRows.size() * sizeof(glm::vec3) + rotationRows.size() * sizeof(PackedQuat) +
+           scaleRows.size() * sizeof(glm::vec3);
+}
+
+CompressedClip compressClip(const RawClip& raw, const ClipCompressionSettings& settings) {
+    CompressedClip clip;
+    size_t tracks = raw.trackCount;
+    size_t frames = std::min<size_t>(raw.frameCount, 65535);
+    clip.trackCount = tracks;
+    clip.frameCount = frames;
+    if (tracks == 0 || frames == 0)
+        return clip;
+
+    auto vectorDistance = [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); };
+
+    // Rest pose from frame 0; constant channels never leave it
+    clip.restPose.resize(tracks);
+    for (size_t track = 0; track < tracks; track++) {
+        clip.restPose.translations[track] = raw.translations[track];
+        clip.restPose.rotations[track] = raw.rotations[track];
+        clip.restPose.scales[track] = raw.scales[track];
+
+        if (!isConstant(raw.translations, tracks, frames, track, settings.translationTolerance, vectorDistance))
+            clip.animatedTranslations.push_back(static_cast<uint16_t>(track));
+        if (!isConstant(raw.rotations, tracks, frames, track, settings.rotationTolerance, rotationAngle))
+            clip.animatedRotations.push_back(static_cast<uint16_t>(track));
+        if (!isConstant(raw.scales, tracks, frames, track, settings.scaleTolerance, vectorDistance))
+            clip.animatedScales.push_back(static_cast<uint16_t>(track));
+    }
+
+    // Rotations as the sampler will see them, so quantization counts against the tolerance
+    std::vector<glm::quat> decoded(frames * clip.animatedRotations.size());
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t channel = 0; channel < clip.animatedRotations.size(); channel++) {
+            decoded[frame * clip.animatedRotations.size() + channel] =
+                unpackQuat(packQuat(raw.rotations[frame * tracks + clip.animatedRotations[channel]]));
+        }
+    }
+
+    // Does interpolating between frames first and last rebuild every frame in between?
+    auto segmentFits = [&](size_t first, size_t last) {
+        for (size_t frame = first + 1; frame < last; frame++) {
+            float alpha = float(frame - first) / float(last - first);
+            for (uint16_t track : clip.animatedTranslations) {
+                glm::vec3 value = glm::mix(raw.translations[first * tracks + track], raw.translations[last * tracks + track], alpha);
+                if (vectorDistance(value, raw.translations[frame * tracks + track]) > settings.translationTolerance)
+                    return false;
+            }
+            for (size_t channel = 0; channel < clip.animatedRotations.size(); channel++) {
+                size_t count = clip.animatedRotations.size();
+                glm::quat value = nlerp(decoded[first * count + channel], decoded[last * count + channel], alpha);
+                if (rotationAngle(value, raw.rotations[frame * tracks + clip.animatedRotations[channel]]) > settings.rotationTolerance)
+                    return false;
+            }
+            for (uint16_t track : clip.animatedScales) {
+                glm::vec3 value = glm::mix(raw.scales[first * tracks + track], raw.scales[last * tracks + track], alpha);
+                if (vectorDistance(value, raw.scales[frame * tracks + track]) > settings.scaleTolerance)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    // Greedy: stretch each segment as far as it still fits
+    clip.keptFrames.push_back(0);
+    for (size_t first = 0; first + 1 < frames; ) {
+        size_t last = first + 1;
+        while (last + 1 < frames && segmentFits(first, last + 1))
+            last++;
+        clip.keptFrames.push_back(static_cast<uint16_t>(last));
+        first = last;
+    }
+
+    clip.rowOfFrame.resize(frames);
+    for (size_t row = 0, frame = 0; frame < frames; frame++) {
+        while (row + 1 < clip.keptFrames.size() && clip.keptFrames[row + 1] <= frame)
+            row++;
+        clip.rowOfFrame[frame] = static_cast<uint16_t>(row);
+    }
+
+    for (uint16_t frame : clip.keptFrames) {
+        for (uint16_t track : clip.animatedTranslations)
+            clip.translationRows.push_back(raw.translations[frame * tracks + track]);
+        for (uint16_t track : clip.animatedRotations)
+            clip.rotationRows.push_back(packQuat(raw.rotations[frame * tracks + track]));
+        for (uint16_t track : clip.animatedScales)
+            clip.scaleRows.push_back(raw.scales[frame * tracks + track]);
+    }
+    return clip;
+}
+
+ClipCompressionReport measureClipError(const RawClip& raw, const CompressedClip& clip) {
+    ClipCompressionReport report;
+    Pose pose;
+    for (size_t frame = 0; frame < clip.frameCount; frame++) {
+        sampleClip(clip, static_cast<float>(frame), pose);
+        for (size_t track = 0; track < clip.trackCount; track++) {
+            size_t slot = frame * raw.trackCount + track;
+            report.maxTranslationError = std::max(report.maxTranslationError, glm::length(pose.translations[track] - raw.translations[slot]));
+            report.maxRotationError = std::max(report.maxRotationError, rotationAngle(pose.rotations[track], raw.rotations[slot]));
+            report.maxScaleError = std::max(report.maxScaleError, glm::length(pose.scales[track] - raw.scales[slot]));
+        }
+    }
+    return report;
+}
+
+void sampleClip(const CompressedClip& clip, float framePosition, Pose& pose) {
+    // Constant channels come straight from the rest pose
+    pose.translations.assign(clip.restPose.translations.begin(), clip.restPose.translations.end());
+    pose.rotations.assign(clip.restPose.rotations.begin(), clip.restPose.rotations.end());
+    pose.scales.assign(clip.restPose.scales.begin(), clip.restPose.scales.end());
+    if (clip.frameCount == 0)
+        return;
+
+    // Source frame to the pair of kept rows around it, then the blend between them
+    float position = std::min(std::max(framePosition, 0.0f), float(clip.frameCount - 1));
+    size_t row0 = clip.rowOfFrame[static_cast<size_t>(position)];
+    size_t row1 = std::min(row0 + 1, clip.keptFrames.size() - 1);
+    float span = float(clip.keptFrames[row1]) - float(clip.keptFrames[row0]);
+    float alpha = span > 0.0f ? std::min((position - clip.keptFrames[row0]) / span, 1.0f) : 0.0f;
+
+    size_t count = clip.animatedTranslations.size();
+    const glm::vec3* t0 = clip.translationRows.data() + row0 * count;
+    const glm::vec3* t1 = clip.translationRows.data() + row1 * count;
+    for (size_t channel = 0; channel < count; channel++)
+        pose.translations[clip.animatedTranslations[channel]] = t0[channel] + (t1[channel] - t0[channel]) * alpha;
+
+    count = clip.animatedRotations.size();
+    const PackedQuat* r0 = clip.rotationRows.data() + row0 * count;
+    const PackedQuat* r1 = clip.rotationRows.data() + row1 * count;
+    for (size_t channel = 0; channel < count; channel++)
+        pose.rotations[clip.animatedRotations[channel]] = nlerp(unpackQuat(r0[channel]), unpackQuat(r1[channel]), alpha);
+
+    count = clip.animatedScales.size();
+    const glm::vec3* s0 = clip.scaleRows.data() + row0 * count;
+    const glm::vec3* s1 = clip.scaleRows.data() + row1 * count;
+    for (size_t channel = 0; channel < count; channel++)
+        pose.scales[clip.animatedScales[channel]] = s0[channel] + (s1[channel] - s0[channel]) * alpha;
+}
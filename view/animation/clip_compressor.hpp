@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "pose.hpp"
+
+// Largest tolerated difference between a compressed clip and its source, per
+// channel in the joint's local space. Errors add up down a chain: a joint ends
+// up to the sum over its ancestors of rotation error (radians) times their
+// distance to it, plus their translation errors, off in model space. For the
+// 0.25 degree default each ancestor adds up to 0.44% of its distance to the joint
+struct ClipCompressionSettings {
+    float rotationTolerance = 0.25f;       // degrees
+    float translationTolerance = 0.1f;     // model units (Mixamo clips are in cm)
+    float scaleTolerance = 0.0001f;
+};
+
+// Unit quaternion in 48 bits: the three smallest components at 15 bits each,
+// the index of the dropped largest one in the spare top bits
+struct PackedQuat {
+    uint16_t v[3];
+};
+
+constexpr float SMALLEST_THREE_RANGE = 0.70710678f;   // 1/sqrt(2)
+
+inline PackedQuat packQuat(glm::quat q) {
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(q[i]) > std::fabs(q[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation; keep the dropped component positive
+    if (q[largest] < 0.0f)
+        q = -q;
+
+    PackedQuat packed;
+    for (int i = 0, slot = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        float unit = (q[i] / SMALLEST_THREE_RANGE + 1.0f) * 0.5f;
+        packed.v[slot++] = static_cast<uint16_t>(std::lround(std::fmin(std::fmax(unit, 0.0f), 1.0f) * 32767.0f));
+    }
+    packed.v[0] |= (largest & 1) << 15;
+    packed.v[1] |= (largest >> 1) << 15;
+    return packed;
+}
+
+inline glm::quat unpackQuat(PackedQuat packed) {
+    int largest = (packed.v[0] >> 15) | ((packed.v[1] >> 15) << 1);
+    float small[3];
+    float sum = 0.0f;
+    for (int slot = 0; slot < 3; slot++) {
+        small[slot] = ((packed.v[slot] & 0x7fff) / 32767.0f * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+        sum += small[slot] * small[slot];
+    }
+
+    glm::quat q;
+    for (int i = 0, slot = 0; i < 4; i++)
+        q[i] = (i == largest) ? std::sqrt(std::fmax(0.0f, 1.0f - sum)) : small[slot++];
+    return q;
+}
+
+// A clip resampled to a fixed rate, every track every frame, frame-major
+struct RawClip {
+    size_t trackCount = 0;
+    size_t frameCount = 0;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+};
+
+// The same clip after compression:
+// - channels constant over the clip are stored once, in the rest pose
+// - animated channels keep only the frames linear interpolation cannot rebuild
+//   within tolerance; the kept frames are shared by all channels, so a
+//   pose is still two contiguous rows and a lerp
+// - animated rotations are smallest-three packed
+struct CompressedClip {
+    size_t trackCount = 0;
+    size_t frameCount = 0;
+
+    Pose restPose;
+
+    std::vector<uint16_t> animatedTranslations;   // track of each animated channel
+    std::vector<uint16_t> animatedRotations;
+    std::vector<uint16_t> animatedScales;
+
+    std::vector<uint16_t> keptFrames;       // source frame of each row
+    std::vector<uint16_t> rowOfFrame;       // last row at or before each source frame
+
+    // [row * animated count + channel]
+    std::vector<glm::vec3> translationRows;
+    std::vector<PackedQuat> rotationRows;
+    std::vector<glm::vec3> scaleRows;
+
+    size_t memoryBytes() const;
+};
+
+// Errors of a compressed clip against its source, over every source frame and
+// per channel, so bounded down a chain only as ClipCompressionSettings says
+struct ClipCompressionReport {
+    float maxRotationError = 0.0f;      // degrees
+    float maxTranslationError = 0.0f;
+    float maxScaleError = 0.0f;
+};
+
+CompressedClip compressClip(const RawClip& raw, const ClipCompressionSettings& settings);
+ClipCompressionReport measureClipError(const RawClip& raw, const CompressedClip& clip);
+
+// Pose at a fractional source frame, clamped to the clip
+void sampleClip(const CompressedClip& clip, float framePosition, Pose& pose);
@@ -0,0 +1,142 @@
+#include "pose.hpp"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define POSE_SSE 1
+#endif
+
+// The kernels below treat poses as flat float arrays
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "vec3 must be tightly packed");
+static_assert(sizeof(glm::quat) == 4 * sizeof(float), "quat must be tightly packed");
+
+namespace {
+
+// out[i] = a[i] + (b[i] - a[i]) * t
+void lerpFloats(const float* a, const float* b, float t, float* out, size_t count) {
+    size_t i = 0;
+#ifdef POSE_SSE
+    __m128 weight = _mm_set1_ps(t);
+    for (; i + 4 <= count; i += 4) {
+        __m128 from = _mm_loadu_ps(a + i);
+        __m128 to = _mm_loadu_ps(b + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), weight)));
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+// Normalized lerp of one quaternion, flipping to to the hemisphere of from
+void nlerpQuat(const float* a, const float* b, float t, float* out) {
+#ifdef POSE_SSE
+    __m128 from = _mm_loadu_ps(a);
+    __m128 to = _mm_loadu_ps(b);
+
+    // Horizontal dot product, broadcast to all lanes
+    __m128 products = _mm_mul_ps(from, to);
+    products = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+    products = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128 sign = _mm_and_ps(products, _mm_set1_ps(-0.0f));
+    to = _mm_xor_ps(to, sign);
+
+    __m128 blended = _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), _mm_set1_ps(t)));
+    __m128 squares = _mm_mul_ps(blended, blended);
+    squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+    squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(1, 0, 3, 2)));
+    _mm_storeu_ps(out, _mm_div_ps(blended, _mm_sqrt_ps(squares)));
+#else
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float flip = dot < 0.0f ? -1.0f : 1.0f;
+    float blended[4];
+    float lengthSquared = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        blended[i] = a[i] + (b[i] * flip - a[i]) * t;
+        lengthSquared += blended[i] * blended[i];
+    }
+    float inverseLength = 1.0f / std::sqrt(lengthSquared);
+    for (int i = 0; i < 4; i++)
+        out[i] = blended[i] * inverseLength;
+#endif
+}
+
+}
+
+void Pose::setIdentity() {
+    std::fill(translations.begin(), translations.end(), glm::vec3(0.0f));
+    std::fill(rotations.begin(), rotations.end(), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    std::fill(scales.begin(), scales.end(), glm::vec3(1.0f));
+}
+
+void blendPoses(const Pose& from, const Pose& to, float weight, Pose& out) {
+    size_t count = std::min(from.size(), to.size());
+    out.resize(count);
+    if (count == 0)
+        return;
+
+    lerpFloats(&from.translations[0].x, &to.translations[0].x, weight, &out.translations[0].x, count * 3);
+    lerpFloats(&from.scales[0].x, &to.scales[0].x, weight, &out.scales[0].x, count * 3);
+
+    const float* fromRotations = &from.rotations[0][0];
+    const float* toRotations = &to.rotations[0][0];
+    float* outRotations = &out.rotations[0][0];
+    for (size_t i = 0; i < count; i++)
+        nlerpQuat(fromRotations + i * 4, toRotations + i * 4, weight, outRotations + i * 4);
+}
+
+void blendPosesMasked(const Pose& from, const Pose& to, const BoneMask& mask, float weight, Pose& out) {
+    if (mask.empty()) {
+        blendPoses(from, to, weight, out);
+        return;
+    }
+
+    size_t count = std::min({from.size(), to.size(), mask.size()});
+    out.resize(std::max(out.size(), count));
+    if (count == 0)
+        return;
+
+    const float* fromRotations = &from.rotations[0][0];
+    const float* toRotations = &to.rotations[0][0];
+    float* outRotations = &out.rotations[0][0];
+    for (size_t i = 0; i < count; i++) {
+        float nodeWeight = mask[i] * weight;
+        if (nodeWeight <= 0.0f) {
+            if (&out != &from) {
+                out.translations[i] = from.translations[i];
+                out.rotations[i] = from.rotations[i];
+                out.scales[i] = from.scales[i];
+            }
+            continue;
+        }
+        out.translations[i] = glm::mix(from.translations[i], to.translations[i], nodeWeight);
+        out.scales[i] = glm::mix(from.scales[i], to.scales[i], nodeWeight);
+        nlerpQuat(fromRotations + i * 4, toRotations + i * 4, nodeWeight, outRotations + i * 4);
+    }
+}
+
+void addPose(const Pose& base, const Pose& pose, const Pose& reference, const BoneMask& mask, float weight, Pose& out) {
+    size_t count = std::min({base.size(), pose.size(), reference.size()});
+    out.resize(std::max(out.size(), count));
+
+    const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        float nodeWeight = mask.empty() ? weight : (i < mask.size() ? mask[i] * weight : 0.0f);
+        if (nodeWeight <= 0.0f) {
+            if (&out != &base) {
+                out.translations[i] = base.translations[i];
+                out.rotations[i] = base.rotations[i];
+                out.scales[i] = base.scales[i];
+            }
+            continue;
+        }
+
+        // Difference from the reference frame, applied in the parent's space like the base
+        glm::quat delta = glm::conjugate(reference.rotations[i]) * pose.rotations[i];
+        glm::quat scaledDelta;
+        nlerpQuat(&identity[0], &delta[0], nodeWeight, &scaledDelta[0]);
+
+        out.translations[i] = base.translations[i] + (pose.translations[i] - reference.translations[i]) * nodeWeight;
+        out.rotations[i] = base.rotations[i] * scaledDelta;
+        out.scales[i] = base.scales[i] * glm::mix(glm::vec3(1.0f), pose.scales[i] / reference.scales[i], nodeWeight);
+    }
+}
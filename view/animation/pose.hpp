@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Local-space transform of every track of a clip, or every node of a
+// skeleton, stored as separate arrays so blending walks contiguous memory
+struct Pose {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    size_t size() const { return rotations.size(); }
+
+    // Only grows the buffers, so a pose reused every frame allocates once
+    void resize(size_t count) {
+        translations.resize(count);
+        rotations.resize(count);
+        scales.resize(count);
+    }
+
+    // Identity transform on every entry
+    void setIdentity();
+};
+
+// Blend weight of each skeleton node, 0 leaving the pose below untouched.
+// An empty mask weights every node 1
+using BoneMask = std::vector<float>;
+
+// Blends from toward to by weight, rotations by normalized lerp along the shortest arc.
+// out may be either input
+void blendPoses(const Pose& from, const Pose& to, float weight, Pose& out);
+
+// Same as blendPoses with weight scaled per node by mask
+void blendPosesMasked(const Pose& from, const Pose& to, const BoneMask& mask, float weight, Pose& out);
+
+// Adds the difference between pose and reference on top of base, scaled per node by
+// mask and weight. out may be base
+void addPose(const Pose& base, const Pose& pose, const Pose& reference, const BoneMask& mask, float weight, Pose& out);
@@ -0,0 +1,296 @@
+#include "pose_kernels.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define POSE_KERNELS_X86 1
+#endif
+
+static_assert(sizeof(Affine3x4) == 12 * sizeof(float), "Affine3x4 must be tightly packed");
+
+Affine3x4 toAffine(const glm::mat4& matrix) {
+    Affine3x4 affine;
+    for (int row = 0; row < 3; row++)
+        affine.rows[row] = glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+    return affine;
+}
+
+glm::mat4 toMat4(const Affine3x4& affine) {
+    glm::mat4 matrix(1.0f);
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 4; column++)
+            matrix[column][row] = affine.rows[row][column];
+    }
+    return matrix;
+}
+
+Affine3x4 composeAffine(const glm::vec3& t, const glm::quat& q, const glm::vec3& s) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    Affine3x4 affine;
+    affine.rows[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy - wz) * s.y, 2.0f * (xz + wy) * s.z, t.x);
+    affine.rows[1] = glm::vec4(2.0f * (xy + wz) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz - wx) * s.z, t.y);
+    affine.rows[2] = glm::vec4(2.0f * (xz - wy) * s.x, 2.0f * (yz + wx) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z);
+    return affine;
+}
+
+void dualQuaternionPalette(const glm::mat4* palette, size_t count, glm::vec4* out) {
+    for (size_t i = 0; i < count; i++) {
+        const glm::mat4& matrix = palette[i];
+        glm::mat3 rotation(glm::normalize(glm::vec3(matrix[0])), glm::normalize(glm::vec3(matrix[1])),
+                           glm::normalize(glm::vec3(matrix[2])));
+        glm::quat real = glm::normalize(glm::quat_cast(rotation));
+        // q and -q are the same rotation; one sign keeps neighbouring bones close for blending
+        if (real.w < 0.0f)
+            real = -real;
+
+        glm::vec3 t(matrix[3]);
+        glm::vec3 r(real.x, real.y, real.z);
+        glm::vec3 dual = 0.5f * (real.w * t + glm::cross(t, r));
+        out[2 * i] = glm::vec4(real.x, real.y, real.z, real.w);
+        out[2 * i + 1] = glm::vec4(dual, -0.5f * glm::dot(t, r));
+    }
+}
+
+namespace {
+
+// Reference: full 4x4 matrices through glm, as the animator used to do it
+
+void composeLocalGlm(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+                     Affine3x4* local, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), translations[i]) * glm::toMat4(rotations[i])
+                         * glm::scale(glm::mat4(1.0f), scales[i]);
+        local[i] = toAffine(matrix);
+    }
+}
+
+void localToGlobalGlm(const Affine3x4* local, const int* parents, Affine3x4* global, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        global[i] = parents[i] >= 0 ? toAffine(toMat4(global[parents[i]]) * toMat4(local[i])) : local[i];
+    }
+}
+
+void skinningMatricesGlm(const Affine3x4* global, const Affine3x4* offsets, const int* boneIds, size_t count,
+                         glm::mat4* palette, size_t paletteSize) {
+    for (size_t i = 0; i < count; i++) {
+        if (boneIds[i] >= 0 && static_cast<size_t>(boneIds[i]) < paletteSize)
+            palette[boneIds[i]] = toMat4(global[i]) * toMat4(offsets[i]);
+    }
+}
+
+const PoseKernels GLM_KERNELS = {"glm", composeLocalGlm, localToGlobalGlm, skinningMatricesGlm};
+
+void composeLocalDirect(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+                        Affine3x4* local, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        local[i] = composeAffine(translations[i], rotations[i], scales[i]);
+}
+
+#ifdef POSE_KERNELS_X86
+
+// SSE2: one row of the result per register. row i of a * b is
+// a[i].x * b0 + a[i].y * b1 + a[i].z * b2 + a[i].w * (0 0 0 1)
+
+inline __m128 multiplyRow(__m128 row, __m128 b0, __m128 b1, __m128 b2, __m128 unitW) {
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+    return _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), unitW));
+}
+
+inline void multiplyAffineSse(const Affine3x4& a, const Affine3x4& b, Affine3x4& out) {
+    const __m128 unitW = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    __m128 b0 = _mm_loadu_ps(&b.rows[0].x);
+    __m128 b1 = _mm_loadu_ps(&b.rows[1].x);
+    __m128 b2 = _mm_loadu_ps(&b.rows[2].x);
+    __m128 r0 = multiplyRow(_mm_loadu_ps(&a.rows[0].x), b0, b1, b2, unitW);
+    __m128 r1 = multiplyRow(_mm_loadu_ps(&a.rows[1].x), b0, b1, b2, unitW);
+    __m128 r2 = multiplyRow(_mm_loadu_ps(&a.rows[2].x), b0, b1, b2, unitW);
+    _mm_storeu_ps(&out.rows[0].x, r0);
+    _mm_storeu_ps(&out.rows[1].x, r1);
+    _mm_storeu_ps(&out.rows[2].x, r2);
+}
+
+// Rows to the columns of a mat4, adding the implicit 0 0 0 1 row
+inline void storeMat4(__m128 r0, __m128 r1, __m128 r2, glm::mat4& out) {
+    __m128 r3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&out[0].x, r0);
+    _mm_storeu_ps(&out[1].x, r1);
+    _mm_storeu_ps(&out[2].x, r2);
+    _mm_storeu_ps(&out[3].x, r3);
+}
+
+void localToGlobalSse(const Affine3x4* local, const int* parents, Affine3x4* global, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (parents[i] >= 0)
+            multiplyAffineSse(global[parents[i]], local[i], global[i]);
+        else
+            global[i] = local[i];
+    }
+}
+
+void skinningMatricesSse(const Affine3x4* global, const Affine3x4* offsets, const int* boneIds, size_t count,
+                         glm::mat4* palette, size_t paletteSize) {
+    const __m128 unitW = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        if (boneIds[i] < 0 || static_cast<size_t>(boneIds[i]) >= paletteSize)
+            continue;
+        __m128 b0 = _mm_loadu_ps(&offsets[i].rows[0].x);
+        __m128 b1 = _mm_loadu_ps(&offsets[i].rows[1].x);
+        __m128 b2 = _mm_loadu_ps(&offsets[i].rows[2].x);
+        storeMat4(multiplyRow(_mm_loadu_ps(&global[i].rows[0].x), b0, b1, b2, unitW),
+                  multiplyRow(_mm_loadu_ps(&global[i].rows[1].x), b0, b1, b2, unitW),
+                  multiplyRow(_mm_loadu_ps(&global[i].rows[2].x), b0, b1, b2, unitW),
+                  palette[boneIds[i]]);
+    }
+}
+
+const PoseKernels SSE2_KERNELS = {"sse2", composeLocalDirect, localToGlobalSse, skinningMatricesSse};
+
+// AVX2 + FMA: eight nodes at a time for the independent TRS conversion,
+// two rows per register for the dependent concatenations
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+// Four values of eight nodes to one row of each node
+AVX2_TARGET inline void storeRows8(__m256 c0, __m256 c1, __m256 c2, __m256 c3, Affine3x4* out, int row) {
+    __m256 t0 = _mm256_unpacklo_ps(c0, c1);
+    __m256 t1 = _mm256_unpackhi_ps(c0, c1);
+    __m256 t2 = _mm256_unpacklo_ps(c2, c3);
+    __m256 t3 = _mm256_unpackhi_ps(c2, c3);
+    __m256 v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm_storeu_ps(&out[0].rows[row].x, _mm256_castps256_ps128(v0));
+    _mm_storeu_ps(&out[1].rows[row].x, _mm256_castps256_ps128(v1));
+    _mm_storeu_ps(&out[2].rows[row].x, _mm256_castps256_ps128(v2));
+    _mm_storeu_ps(&out[3].rows[row].x, _mm256_castps256_ps128(v3));
+    _mm_storeu_ps(&out[4].rows[row].x, _mm256_extractf128_ps(v0, 1));
+    _mm_storeu_ps(&out[5].rows[row].x, _mm256_extractf128_ps(v1, 1));
+    _mm_storeu_ps(&out[6].rows[row].x, _mm256_extractf128_ps(v2, 1));
+    _mm_storeu_ps(&out[7].rows[row].x, _mm256_extractf128_ps(v3, 1));
+}
+
+AVX2_TARGET void composeLocalAvx2(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+                                  Affine3x4* local, size_t count) {
+    const float* t = &translations[0].x;
+    const float* q = &rotations[0].x;
+    const float* s = &scales[0].x;
+    const __m256i vec3Stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i quatStride = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Gathered into one register per component, eight nodes across
+        __m256 qx = _mm256_i32gather_ps(q + i * 4 + 0, quatStride, 4);
+        __m256 qy = _mm256_i32gather_ps(q + i * 4 + 1, quatStride, 4);
+        __m256 qz = _mm256_i32gather_ps(q + i * 4 + 2, quatStride, 4);
+        __m256 qw = _mm256_i32gather_ps(q + i * 4 + 3, quatStride, 4);
+        __m256 sx = _mm256_i32gather_ps(s + i * 3 + 0, vec3Stride, 4);
+        __m256 sy = _mm256_i32gather_ps(s + i * 3 + 1, vec3Stride, 4);
+        __m256 sz = _mm256_i32gather_ps(s + i * 3 + 2, vec3Stride, 4);
+        __m256 tx = _mm256_i32gather_ps(t + i * 3 + 0, vec3Stride, 4);
+        __m256 ty = _mm256_i32gather_ps(t + i * 3 + 1, vec3Stride, 4);
+        __m256 tz = _mm256_i32gather_ps(t + i * 3 + 2, vec3Stride, 4);
+
+        __m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+        __m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+        __m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+
+        __m256 m00 = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx);
+        __m256 m01 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        __m256 m02 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        __m256 m10 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        __m256 m11 = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy);
+        __m256 m12 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        __m256 m20 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        __m256 m21 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        __m256 m22 = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz);
+
+        storeRows8(m00, m01, m02, tx, local + i, 0);
+        storeRows8(m10, m11, m12, ty, local + i, 1);
+        storeRows8(m20, m21, m22, tz, local + i, 2);
+    }
+    for (; i < count; i++)
+        local[i] = composeAffine(translations[i], rotations[i], scales[i]);
+}
+
+// Rows 0 and 1 of a * b in one register, row 2 in another
+AVX2_TARGET inline void multiplyAffineAvx2(const Affine3x4& a, const Affine3x4& b, __m256& rows01, __m128& row2) {
+    __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[0].x));
+    __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[1].x));
+    __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[2].x));
+    const __m256 unitW = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+    __m256 a01 = _mm256_loadu_ps(&a.rows[0].x);
+    rows01 = _mm256_mul_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(3, 3, 3, 3)), unitW);
+    rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0)), b0, rows01);
+    rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1)), b1, rows01);
+    rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2)), b2, rows01);
+
+    __m128 a2 = _mm_loadu_ps(&a.rows[2].x);
+    row2 = _mm_mul_ps(_mm_permute_ps(a2, _MM_SHUFFLE(3, 3, 3, 3)), _mm256_castps256_ps128(unitW));
+    row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_castps256_ps128(b0), row2);
+    row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_castps256_ps128(b1), row2);
+    row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_castps256_ps128(b2), row2);
+}
+
+AVX2_TARGET void localToGlobalAvx2(const Affine3x4* local, const int* parents, Affine3x4* global, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (parents[i] < 0) {
+            global[i] = local[i];
+            continue;
+        }
+        __m256 rows01;
+        __m128 row2;
+        multiplyAffineAvx2(global[parents[i]], local[i], rows01, row2);
+        _mm256_storeu_ps(&global[i].rows[0].x, rows01);
+        _mm_storeu_ps(&global[i].rows[2].x, row2);
+    }
+}
+
+AVX2_TARGET void skinningMatricesAvx2(const Affine3x4* global, const Affine3x4* offsets, const int* boneIds, size_t count,
+                                      glm::mat4* palette, size_t paletteSize) {
+    for (size_t i = 0; i < count; i++) {
+        if (boneIds[i] < 0 || static_cast<size_t>(boneIds[i]) >= paletteSize)
+            continue;
+        __m256 rows01;
+        __m128 row2;
+        multiplyAffineAvx2(global[i], offsets[i], rows01, row2);
+        storeMat4(_mm256_castps256_ps128(rows01), _mm256_extractf128_ps(rows01, 1), row2, palette[boneIds[i]]);
+    }
+}
+
+const PoseKernels AVX2_KERNELS = {"avx2", composeLocalAvx2, localToGlobalAvx2, skinningMatricesAvx2};
+
+bool cpuSupportsAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif
+
+}
+
+std::vector<const PoseKernels*> supportedPoseKernels() {
+    std::vector<const PoseKernels*> kernels = {&GLM_KERNELS};
+#ifdef POSE_KERNELS_X86
+    kernels.push_back(&SSE2_KERNELS);
+    if (cpuSupportsAvx2())
+        kernels.push_back(&AVX2_KERNELS);
+#endif
+    return kernels;
+}
+
+const PoseKernels& poseKernels() {
+    static const PoseKernels& selected = *supportedPoseKernels().back();
+    return selected;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Affine transform as the first three rows of a 4x4 matrix, the fourth
+// always being 0 0 0 1. A quarter smaller than a mat4 and a quarter
+// fewer multiplies to concatenate
+struct Affine3x4 {
+    glm::vec4 rows[3];
+};
+
+Affine3x4 toAffine(const glm::mat4& matrix);
+glm::mat4 toMat4(const Affine3x4& affine);
+
+// translate * rotate * scale, written straight into the rows
+Affine3x4 composeAffine(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+// Rigid part of each palette matrix as a dual quaternion, two vec4 per bone:
+// the rotation, then half the translation times it, both x y z w. Scale is
+// dropped, which the skins' palettes do not have
+void dualQuaternionPalette(const glm::mat4* palette, size_t count, glm::vec4* out);
+
+// Batch kernels turning a local pose into a skinning palette. Every
+// implementation gives the same results up to rounding
+struct PoseKernels {
+    const char* name;
+
+    // TRS of count nodes to their local matrices
+    void (*composeLocal)(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+                         Affine3x4* local, size_t count);
+
+    // Parents come before their children, -1 for roots. global must not alias local
+    void (*localToGlobal)(const Affine3x4* local, const int* parents, Affine3x4* global, size_t count);
+
+    // palette[boneIds[i]] = global[i] * offsets[i], for nodes with a bone below paletteSize
+    void (*skinningMatrices)(const Affine3x4* global, const Affine3x4* offsets, const int* boneIds, size_t count,
+                             glm::mat4* palette, size_t paletteSize);
+};
+
+// Fastest implementation the CPU supports, detected once
+const PoseKernels& poseKernels();
+
+// Every implementation the CPU supports, starting with the plain glm one
+std::vector<const PoseKernels*> supportedPoseKernels();
@@ -0,0 +1,68 @@
+#include "crowd.hpp"
+#include <iostream>
+
+Crowd::Crowd(std::shared_ptr<Model> model, const BakedAnimationSet& baked)
+    : model(std::move(model)), clips(baked.clips) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (baked.rowCount() == 0 || static_cast<GLint>(baked.width()) > maxSize || static_cast<GLint>(baked.rowCount()) > maxSize) {
+        std::cerr << "Cannot upload baked animations of " << baked.width() << "x" << baked.rowCount()
+                  << " texels, the limit is " << maxSize << std::endl;
+        return;
+    }
+
+    // Fetched with texelFetch, so no filtering or mips
+    boneTexture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, boneTexture.get());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, baked.width(), baked.rowCount(), 0, GL_RGBA, GL_FLOAT, baked.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    instanceBuffer = GLBuffer::create();
+}
+
+bool Crowd::add(const glm::mat4& transform, const std::string& clip, float timeOffset) {
+    for (const auto& baked : clips) {
+        if (baked.name != clip)
+            continue;
+
+        InstanceData instance;
+        instance.transform = transform;
+        instance.animation = glm::vec4(baked.firstRow, baked.frameCount, baked.framesPerSecond, timeOffset);
+        instances.push_back(instance);
+        instancesChanged = true;
+        return true;
+    }
+
+    std::cerr << "Clip " << clip << " was not baked" << std::endl;
+    return false;
+}
+
+void Crowd::clear() {
+    instances.clear();
+    instancesChanged = true;
+}
+
+void Crowd::draw(GLuint shaderProgram, float time) {
+    if (!isValid() || !model || instances.empty())
+        return;
+
+    // Instances only move when added or removed, so the buffer is rewritten rarely
+    if (instancesChanged) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        instancesChanged = false;
+    }
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, boneTexture.get());
+    glUniform1i(glGetUniformLocation(shaderProgram, "bakedBones"), 1);
+    glUniform1f(glGetUniformLocation(shaderProgram, "time"), time);
+    glActiveTexture(GL_TEXTURE0);
+
+    model->drawInstanced(shaderProgram, instanceBuffer.get(), static_cast<GLsizei>(instances.size()));
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "model.hpp"
+#include "gl_resource.hpp"
+#include "animation/baked_animation.hpp"
+
+// Characters animated entirely on the GPU from baked bone palettes, for
+// spectators and distant players. Costs no CPU animation work and one
+// instanced draw per material, whatever the number of instances
+class Crowd {
+public:
+    // model must be the mesh whose skeleton the palettes were baked from
+    Crowd(std::shared_ptr<Model> model, const BakedAnimationSet& baked);
+
+    bool isValid() const { return static_cast<bool>(boneTexture); }
+
+    // Adds an instance playing clip from timeOffset seconds in. False if the clip was not baked
+    bool add(const glm::mat4& transform, const std::string& clip, float timeOffset = 0.0f);
+    void clear();
+    size_t size() const { return instances.size(); }
+
+    // Draws every instance with the crowd shader, at time seconds
+    void draw(GLuint shaderProgram, float time);
+
+private:
+    std::shared_ptr<Model> model;
+    std::vector<BakedClip> clips;
+    GLTexture boneTexture;
+    GLBuffer instanceBuffer;
+    std::vector<InstanceData> instances;
+    bool instancesChanged = false;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <glad/glad.hpp>
+#include <utility>
+
+// Owns one GL object name and deletes it with the owner. Move-only, so a
+// name is never deleted twice or left behind by a copy
+template <typename Traits>
+class GLHandle {
+public:
+    GLHandle() = default;
+    explicit GLHandle(GLuint name) : name(name) {}
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+    GLHandle(GLHandle&& other) noexcept : name(other.name) { other.name = 0; }
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            reset(other.name);
+            other.name = 0;
+        }
+        return *this;
+    }
+    ~GLHandle() { reset(); }
+
+    static GLHandle create() { return GLHandle(Traits::create()); }
+
+    GLuint get() const { return name; }
+    explicit operator bool() const { return name != 0; }
+
+    void reset(GLuint replacement = 0) {
+        if (name)
+            Traits::destroy(name);
+        name = replacement;
+    }
+
+private:
+    GLuint name = 0;
+};
+
+struct GLBufferTraits {
+    static GLuint create() { GLuint name; glGenBuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteBuffers(1, &name); }
+};
+
+struct GLVertexArrayTraits {
+    static GLuint create() { GLuint name; glGenVertexArrays(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteVertexArrays(1, &name); }
+};
+
+struct GLTextureTraits {
+    static GLuint create() { GLuint name; glGenTextures(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteTextures(1, &name); }
+};
+
+using GLBuffer = GLHandle<GLBufferTraits>;
+using GLVertexArray = GLHandle<GLVertexArrayTraits>;
+using GLTexture = GLHandle<GLTextureTraits>;
@@ -0,0 +1,223 @@
+#include "hot_reload.hpp"
+#include "model_cache.hpp"
+#include "texture_manager.hpp"
+#include "texture_compressor.hpp"
+#include "animation/animation_library.hpp"
+#include "animation/animation_system.hpp"
+#include <filesystem>
+#include <memory>
+#include <iostream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// How long a file must stay untouched before its change is reported
+constexpr std::chrono::milliseconds SETTLE_TIME(150);
+
+AssetWatcher::AssetWatcher(const std::string& root) : root(root) {}
+
+AssetWatcher::~AssetWatcher() {
+    stop();
+}
+
+#ifdef __linux__
+
+bool AssetWatcher::start() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cerr << "Hot reload: inotify unavailable" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    addWatch(root);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root, error)) {
+        if (entry.is_directory())
+            addWatch(entry.path().string());
+    }
+    if (watchedDirectories.empty()) {
+        std::cerr << "Hot reload: cannot watch " << root << std::endl;
+        stop();
+        return false;
+    }
+
+    std::cout << "Hot reload: watching " << watchedDirectories.size() << " directories under " << root << std::endl;
+    running = true;
+    thread = std::thread(&AssetWatcher::watchLoop, this);
+    return true;
+}
+
+void AssetWatcher::stop() {
+    running = false;
+    if (thread.joinable())
+        thread.join();
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+    inotifyFd = -1;
+    watchedDirectories.clear();
+}
+
+void AssetWatcher::addWatch(const std::string& directory) {
+    // Writes end in CLOSE_WRITE, while editors that save through a temporary file end in MOVED_TO
+    int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd >= 0)
+        watchedDirectories[wd] = directory;
+}
+
+void AssetWatcher::watchLoop() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd pfd{inotifyFd, POLLIN, 0};
+
+    while (running) {
+        // Short timeout so stop() is never kept waiting
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length; ) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                auto dir = watchedDirectories.find(event->wd);
+                if (dir == watchedDirectories.end() || event->len == 0)
+                    continue;
+                std::string path = dir->second + "/" + event->name;
+
+                if (event->mask & IN_ISDIR) {
+                    // New folders, such as a freshly added skin, are watched too
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                        addWatch(path);
+                } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    changed[path] = std::chrono::steady_clock::now();
+                }
+            }
+        }
+    }
+}
+
+#else
+
+bool AssetWatcher::start() {
+    std::cerr << "Hot reload: file watching is only supported on Linux" << std::endl;
+    return false;
+}
+
+void AssetWatcher::stop() {}
+void AssetWatcher::addWatch(const std::string&) {}
+void AssetWatcher::watchLoop() {}
+
+#endif
+
+std::vector<std::string> AssetWatcher::takeChanged() {
+    std::vector<std::string> settled;
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = changed.begin(); it != changed.end(); ) {
+        if (now - it->second >= SETTLE_TIME) {
+            settled.push_back(it->first);
+            it = changed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return settled;
+}
+
+HotReloader::HotReloader(const std::string& root) : watcher(root), worker(1) {}
+
+void HotReloader::update() {
+    for (const auto& path : watcher.takeChanged()) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+            reloadTexture(path);
+        else if (extension == ".fbx" && AnimationLibrary::instance().contains(path))
+            reloadClip(path);
+        else if (extension == ".fbx" || extension == ".obj")
+            reloadModel(path);
+        // Anything else, cooked .ktx output included, needs no action
+    }
+
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(finished);
+    }
+    for (auto& apply : ready)
+        apply();
+}
+
+void HotReloader::reloadTexture(const std::string& path) {
+    // A texture that was cooked before is cooked again, or the loader would
+    // fall back to decoding the source now that the KTX is older than it
+    std::string ktxPath = cookedTexturePath(path);
+    if (!std::filesystem::exists(ktxPath)) {
+        if (TextureManager::instance().reload(path))
+            std::cout << "Hot reload: " << path << std::endl;
+        return;
+    }
+
+    worker.enqueue([this, path, ktxPath] {
+        auto start = std::chrono::steady_clock::now();
+        bool cooked = cookTexture(path, ktxPath);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back([path, cooked, ms] {
+            if (!cooked)
+                std::cerr << "Hot reload: re-cooking " << path << " failed, loading the source" << std::endl;
+            if (TextureManager::instance().reload(path))
+                std::cout << "Hot reload: " << path << " (re-cooked in " << ms << " ms)" << std::endl;
+        });
+    });
+}
+
+void HotReloader::reloadModel(const std::string& path) {
+    // Only models in use are re-imported; others load fresh when first needed
+    if (!ModelCache::instance().contains(path))
+        return;
+
+    worker.enqueue([this, path] {
+        auto start = std::chrono::steady_clock::now();
+        auto model = std::make_shared<Model>(path, false);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back([path, model, ms] {
+            // A file caught half-written or broken keeps the current model on screen
+            if (!model->hasGeometry()) {
+                std::cerr << "Hot reload: " << path << " failed to import, keeping the loaded version" << std::endl;
+                return;
+            }
+            if (ModelCache::instance().replace(path, std::move(*model)))
+                std::cout << "Hot reload: " << path << " (re-imported in " << ms << " ms)" << std::endl;
+        });
+    });
+}
+
+void HotReloader::reloadClip(const std::string& path) {
+    worker.enqueue([this, path] {
+        auto start = std::chrono::steady_clock::now();
+        auto animation = AnimationLibrary::import(path);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back([path, animation, ms] {
+            if (!animation) {
+                std::cerr << "Hot reload: " << path << " failed to import, keeping the loaded clip" << std::endl;
+                return;
+            }
+            // Animators hold track bindings into the clip, so none may be sampling it while it changes
+            AnimationSystem::instance().finish();
+            const Animation* replaced = AnimationLibrary::instance().replace(path, std::move(*animation));
+            if (!replaced)
+                return;
+            AnimationSystem::instance().rebindAnimation(replaced);
+            std::cout << "Hot reload: " << path << " (re-imported in " << ms << " ms)" << std::endl;
+        });
+    });
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "thread_pool.hpp"
+
+// Reports files written under a directory tree, through inotify on Linux.
+// Events are gathered on a background thread and handed out once a file has
+// been quiet for a moment, so an editor saving in several writes reloads once
+class AssetWatcher {
+public:
+    explicit AssetWatcher(const std::string& root);
+    ~AssetWatcher();
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    // False where file watching is unsupported or the root cannot be watched
+    bool start();
+    void stop();
+
+    // Files changed and settled since the last call
+    std::vector<std::string> takeChanged();
+
+private:
+    void watchLoop();
+    void addWatch(const std::string& directory);
+
+    std::string root;
+    int inotifyFd = -1;
+    std::map<int, std::string> watchedDirectories;
+
+    std::mutex mutex;
+    std::map<std::string, std::chrono::steady_clock::time_point> changed;
+
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+// Development mode: re-imports models and re-cooks textures whose files
+// changed, in the background, and swaps the results in at a frame boundary
+class HotReloader {
+public:
+    explicit HotReloader(const std::string& root);
+
+    bool start() { return watcher.start(); }
+
+    // Dispatches new changes and applies finished reloads, once per frame on the GL thread
+    void update();
+
+private:
+    void reloadTexture(const std::string& path);
+    void reloadModel(const std::string& path);
+    void reloadClip(const std::string& path);
+
+    AssetWatcher watcher;
+
+    // Work finished on the worker, waiting for the GL thread
+    std::mutex mutex;
+    std::vector<std::function<void()>> finished;
+
+    // Declared last so the worker is joined before the queue above is destroyed
+    ThreadPool worker;
+};
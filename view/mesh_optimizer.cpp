@@ -0,0 +1,210 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <numeric>
+
+float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    if (indices.size() < 3)
+        return 0.0f;
+
+    // Timestamp of the last time each vertex entered the FIFO
+    std::vector<size_t> cachedAt(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t misses = 0;
+
+    for (unsigned int index : indices) {
+        if (time - cachedAt[index] > cacheSize) {
+            cachedAt[index] = time++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         std::vector<size_t>& clusterStarts, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    clusterStarts.clear();
+    if (triangleCount == 0)
+        return;
+
+    // Vertex to triangle adjacency, stored as offsets into a flat list
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveTriangles[index]++;
+
+    std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+
+    std::vector<size_t> adjacency(indices.size());
+    std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+
+    std::vector<size_t> cachedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    long fanning = indices[0];
+    bool newCluster = true;
+
+    while (fanning >= 0) {
+        if (newCluster) {
+            clusterStarts.push_back(output.size() / 3);
+            newCluster = false;
+        }
+
+        candidates.clear();
+        for (size_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++) {
+            size_t t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cachedAt[v] > cacheSize)
+                    cachedAt[v] = time++;
+            }
+        }
+
+        // Prefer the candidate that stays in cache longest while its fan is emitted
+        long next = -1;
+        long bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (liveTriangles[v] == 0)
+                continue;
+            long priority = 0;
+            if (time - cachedAt[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = static_cast<long>(time - cachedAt[v]);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next == -1) {
+            // Dead end: back up through recently used vertices, then scan forward
+            newCluster = true;
+            while (!deadEnd.empty() && next == -1) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0)
+                    next = v;
+            }
+            while (next == -1 && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0)
+                    next = static_cast<long>(cursor);
+                cursor++;
+            }
+        }
+
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<size_t>& clusterStarts,
+                      const std::vector<Vertex>& vertices) {
+    const size_t triangleCount = indices.size() / 3;
+    if (clusterStarts.size() < 2)
+        return;
+
+    glm::vec3 meshCenter(0.0f);
+    for (const auto& vertex : vertices)
+        meshCenter += vertex.position;
+    meshCenter = meshCenter / static_cast<float>(vertices.size());
+
+    struct Cluster {
+        size_t first;
+        size_t count;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        size_t first = clusterStarts[c];
+        size_t last = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+
+        // Area-weighted centroid and normal of the cluster
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = first; t < last; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+
+        float sortKey = 0.0f;
+        if (area > 0.0f && glm::length(normal) > 0.0f)
+            sortKey = glm::dot(centroid / area - meshCenter, glm::normalize(normal));
+        clusters.push_back({first, last - first, sortKey});
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (const auto& cluster : clusters)
+        output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + (cluster.first + cluster.count) * 3);
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
+
+MeshOptimizeReport optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, bool sortForOverdraw) {
+    MeshOptimizeReport report;
+    report.acmrBefore = computeACMR(indices, vertices.size());
+
+    std::vector<size_t> clusterStarts;
+    optimizeVertexCache(indices, vertices.size(), clusterStarts);
+
+    if (sortForOverdraw) {
+        // Only keep the overdraw order if it costs little vertex cache efficiency
+        std::vector<unsigned int> cacheOrder = indices;
+        float cacheAcmr = computeACMR(indices, vertices.size());
+        optimizeOverdraw(indices, clusterStarts, vertices);
+        if (computeACMR(indices, vertices.size()) > cacheAcmr * 1.05f)
+            indices.swap(cacheOrder);
+    }
+
+    optimizeVertexFetch(vertices, indices);
+
+    report.acmrAfter = computeACMR(indices, vertices.size());
+    return report;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "model.hpp"
+
+// Post-transform cache size the optimizer targets, conservative for current GPUs
+constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct MeshOptimizeReport {
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+};
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO cache.
+// 3.0 means no reuse at all, around 0.6 is excellent for a closed mesh
+float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander, Nehab, Barczak 2007): reorders triangles for post-transform
+// cache hits. Fills clusterStarts with the first triangle of every cluster, the
+// points where the walk had to jump to a non-adjacent vertex
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         std::vector<size_t>& clusterStarts, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Orders clusters so outward-facing ones come first, which lets early depth
+// testing reject more of the fragments behind them
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<size_t>& clusterStarts,
+                      const std::vector<Vertex>& vertices);
+
+// Renumbers vertices in first-use order so fetches walk the vertex buffer
+// linearly. Vertices no triangle references are dropped
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Runs the whole import stage on one mesh
+MeshOptimizeReport optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, bool sortForOverdraw);
@@ -1,70 +1,308 @@
 #include "model.hpp"
+#include "texture_loader.hpp"
+#include "texture_manager.hpp"
+#include "mesh_optimizer.hpp"
+#include "animation/animation_library.hpp"
 #include <iostream>
 #include <filesystem>
 #define STB_IMAGE_IMPLEMENTATION
 #include "resources/stb_image.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<Texture>& textures)
-    : textures(textures) {
-    setupMesh(vertices, indices);
+// Cluster order favours triangles facing away from the mesh centre, cutting overdraw
+constexpr bool SORT_CLUSTERS_FOR_OVERDRAW = true;
+
+// Largest packed skinning error checkVertexPacking() accepts, as a fraction of the
+// bounding radius; half-float positions alone stay near 0.05%
+constexpr float PACKING_TOLERANCE = 0.005f;
+
+Mesh::Mesh(std::vector<MeshData>& materials, GeometryStats& stats) {
+    setupMesh(materials, stats);
 }
 
-void Mesh::setupMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
-    indexCount = indices.size();
+void Mesh::setupMesh(std::vector<MeshData>& materials, GeometryStats& stats) {
+    std::vector<PackedVertex> packed;
+    std::vector<uint8_t> indexData;
+
+    for (auto& material : materials) {
+        SubMesh subMesh;
+        subMesh.textures = material.textures;
+        subMesh.indexCount = material.indices.size();
+        subMesh.baseVertex = static_cast<GLint>(packed.size());
+
+        for (const auto& vertex : material.vertices) {
+            packed.push_back(packVertex(vertex, stats));
+        }
+        stats.vertexCount += material.vertices.size();
+
+        // Ranges are relative to their base vertex, so each material whose own
+        // vertices fit in 16 bits gets half-size indices. Offsets stay 4-byte aligned
+        indexData.resize((indexData.size() + 3) & ~size_t(3));
+        subMesh.indexOffset = indexData.size();
+
+        if (material.vertices.size() <= 65536) {
+            subMesh.indexType = GL_UNSIGNED_SHORT;
+            indexData.resize(indexData.size() + material.indices.size() * sizeof(uint16_t));
+            uint16_t* out = reinterpret_cast<uint16_t*>(indexData.data() + subMesh.indexOffset);
+            for (size_t i = 0; i < material.indices.size(); i++) {
+                out[i] = static_cast<uint16_t>(material.indices[i]);
+            }
+            stats.indexBytes += material.indices.size() * sizeof(uint16_t);
+            stats.indexBytesSaved += material.indices.size() * (sizeof(unsigned int) - sizeof(uint16_t));
+        } else {
+            subMesh.indexType = GL_UNSIGNED_INT;
+            indexData.resize(indexData.size() + material.indices.size() * sizeof(unsigned int));
+            std::memcpy(indexData.data() + subMesh.indexOffset, material.indices.data(), material.indices.size() * sizeof(unsigned int));
+            stats.indexBytes += material.indices.size() * sizeof(unsigned int);
+        }
+
+        subMeshes.push_back(subMesh);
+    }
+
+    VAO = GLVertexArray::create();
+    VBO = GLBuffer::create();
+    EBO = GLBuffer::create();
+
+    glBindVertexArray(VAO.get());
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
 
-    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    bindVertexAttributes();
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
+void Mesh::bindVertexAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
 
     // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
     glEnableVertexAttribArray(0);
 
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    // Normal attribute (packed 2_10_10_10, the w component is ignored by the shader)
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
     glEnableVertexAttribArray(1);
 
-    // Texture coordinates attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    // Texture coordinates attribute (half floats)
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
     glEnableVertexAttribArray(2);
     
-    // Bone IDs attribute (as integers)
-    glVertexAttribIPointer(3, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, boneIDs));
+    // Bone IDs attribute (as unsigned integers)
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, boneIDs));
     glEnableVertexAttribArray(3);
     
-    // Bone weights attribute
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
+    // Bone weights attribute (normalized bytes)
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, weights));
     glEnableVertexAttribArray(4);
+}
+
+PackedVertex packVertex(const Vertex& vertex, GeometryStats& stats) {
+    PackedVertex packed;
+    packed.position = vertex.position;
+
+    glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : glm::vec3(0.0f);
+    packed.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    packed.texCoords = glm::packHalf2x16(vertex.texCoords);
+
+    // Round every weight to 1/255, then hand the rounding residual to the heaviest
+    // slot so the quantized weights still sum to exactly one
+    int quantized[4];
+    int sum = 0;
+    int heaviest = 0;
+    for (int i = 0; i < 4; i++) {
+        float weight = vertex.boneIDs[i] < 0 ? 0.0f : glm::clamp(vertex.weights[i], 0.0f, 1.0f);
+        quantized[i] = static_cast<int>(std::lround(weight * 255.0f));
+        sum += quantized[i];
+        if (quantized[i] > quantized[heaviest])
+            heaviest = i;
+    }
+    if (sum > 0)
+        quantized[heaviest] += 255 - sum;
+
+    for (int i = 0; i < 4; i++) {
+        packed.boneIDs[i] = vertex.boneIDs[i] < 0 ? 0 : static_cast<uint16_t>(vertex.boneIDs[i]);
+        packed.weights[i] = static_cast<uint8_t>(quantized[i]);
+
+        float original = vertex.boneIDs[i] < 0 ? 0.0f : vertex.weights[i];
+        stats.maxWeightError = std::max(stats.maxWeightError, std::abs(original - quantized[i] / 255.0f));
+    }
+
+    if (normal != glm::vec3(0.0f)) {
+        glm::vec3 decoded = glm::vec3(glm::unpackSnorm3x10_1x2(packed.normal));
+        float cosine = glm::clamp(glm::dot(normal, glm::normalize(decoded)), -1.0f, 1.0f);
+        stats.maxNormalError = std::max(stats.maxNormalError, glm::degrees(std::acos(cosine)));
+    }
+
+    return packed;
+}
+
+namespace {
+
+// CPU copy of the linear skinning in the vertex shader
+glm::vec3 skinPosition(const glm::vec3& position, const int boneIDs[4], const float weights[4],
+    const std::vector<glm::mat4>& palette) {
+    glm::vec4 total(0.0f);
+    for (int i = 0; i < 4; i++) {
+        if (weights[i] == 0.0f || boneIDs[i] < 0 || static_cast<size_t>(boneIDs[i]) >= palette.size())
+            continue;
+        total += palette[boneIDs[i]] * glm::vec4(position, 1.0f) * weights[i];
+    }
+    return total == glm::vec4(0.0f) ? position : glm::vec3(total);
+}
 
-    glBindVertexArray(0);
 }
 
 void Mesh::draw(GLuint shaderProgram) {
-    if (!textures.empty()) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0].id);
-        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
-        glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 0);
-    } else {
-        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
+    glBindVertexArray(VAO.get());
+
+    for (const auto& subMesh : subMeshes) {
+        if (!subMesh.textures.empty()) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, subMesh.textures[0].handle.id());
+            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
+            glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 0);
+        } else {
+            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
+        }
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.indexCount, subMesh.indexType,
+            (void*)subMesh.indexOffset, subMesh.baseVertex);
+    }
+
+    glBindVertexArray(0);
+}
+
+void Mesh::drawInstanced(GLuint shaderProgram, GLuint instanceBuffer, GLsizei instanceCount) {
+    // A second vertex array reads the same geometry plus one InstanceData per instance
+    if (!instancedVAO || boundInstanceBuffer != instanceBuffer) {
+        instancedVAO = GLVertexArray::create();
+        boundInstanceBuffer = instanceBuffer;
+
+        glBindVertexArray(instancedVAO.get());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+        bindVertexAttributes();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (GLuint column = 0; column < 4; column++) {
+            glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                (void*)(offsetof(InstanceData, transform) + column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(5 + column);
+            glVertexAttribDivisor(5 + column, 1);
+        }
+        glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, animation));
+        glEnableVertexAttribArray(9);
+        glVertexAttribDivisor(9, 1);
+    }
+
+    glBindVertexArray(instancedVAO.get());
+    for (const auto& subMesh : subMeshes) {
+        if (!subMesh.textures.empty()) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, subMesh.textures[0].handle.id());
+            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
+            glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 0);
+        } else {
+            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
+        }
+
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, subMesh.indexCount, subMesh.indexType,
+            (void*)subMesh.indexOffset, instanceCount, subMesh.baseVertex);
     }
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
     glBindVertexArray(0);
 }
 
-Model::Model(const std::string& path) {
+void Mesh::requestTextureDetail(float screenPixels) const {
+    for (const auto& subMesh : subMeshes) {
+        for (const auto& texture : subMesh.textures) {
+            TextureManager::instance().requestDetail(texture.handle, screenPixels);
+        }
+    }
+}
+
+float Model::packingError(const Animator& pose, size_t sampleCount) const {
+    size_t vertexCount = 0;
+    for (const auto& material : pendingMaterials)
+        vertexCount += material.vertices.size();
+    size_t stride = std::max<size_t>(1, vertexCount / std::max<size_t>(1, sampleCount));
+
+    const auto& palette = pose.getFinalBoneMatrices();
+    GeometryStats stats;
+    float maxError = 0.0f;
+    size_t index = 0;
+    for (const auto& material : pendingMaterials) {
+        for (const auto& vertex : material.vertices) {
+            if (index++ % stride != 0)
+                continue;
+
+            PackedVertex packed = packVertex(vertex, stats);
+            int packedIDs[4];
+            float packedWeights[4];
+            for (int i = 0; i < 4; i++) {
+                packedIDs[i] = packed.boneIDs[i];
+                packedWeights[i] = packed.weights[i] / 255.0f;
+            }
+
+            glm::vec3 full = skinPosition(vertex.position, vertex.boneIDs, vertex.weights, palette);
+            glm::vec3 quantized = skinPosition(packed.position, packedIDs, packedWeights, palette);
+            maxError = std::max(maxError, glm::length(full - quantized));
+        }
+    }
+    return maxError;
+}
+
+bool checkVertexPacking(const std::string& modelPath, const std::string& clipPath) {
+    // CPU import only, no GL context is needed
+    Model model(modelPath, false);
+    if (!model.hasSkeleton() || !model.hasGeometry()) {
+        std::cerr << "No skinned geometry in " << modelPath << std::endl;
+        return false;
+    }
+    auto clip = AnimationLibrary::instance().load(clipPath);
+    if (!clip || clip->getTicksPerSecond() <= 0.0f)
+        return false;
+
+    const size_t sampleCount = 4096;
+    const int timeCount = 8;
+    float seconds = clip->getDuration() / clip->getTicksPerSecond();
+    auto animator = model.createAnimator();
+    animator->playAnimation(clip.get());
+    animator->updateAnimation(0.0f);
+
+    float worst = 0.0f;
+    for (int step = 0; step < timeCount; step++) {
+        float error = model.packingError(*animator, sampleCount);
+        worst = std::max(worst, error);
+        std::cout << "t = " << seconds * step / timeCount << " s: " << error << " units max" << std::endl;
+        animator->updateAnimation(seconds / timeCount);
+    }
+
+    float radius = model.getBoundingRadius();
+    if (radius <= 0.0f) {
+        std::cerr << "Packed layout of " << modelPath << ": no extent to compare against" << std::endl;
+        return false;
+    }
+
+    std::cout << "Packed layout of " << modelPath << ": " << worst << " units max over "
+              << timeCount << " poses, " << 100.0f * worst / radius
+              << "% of the bounding radius (tolerance " << 100.0f * PACKING_TOLERANCE << "%)" << std::endl;
+    if (worst > PACKING_TOLERANCE * radius) {
+        std::cerr << "Packed layout of " << modelPath << " exceeds the tolerance" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Model::Model(const std::string& path, bool uploadNow) : path(path) {
     
     size_t lastSlash = path.find_last_of("/\\");
     directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash);
@@ -72,6 +310,7 @@ Model::Model(const std::string& path) {
     Assimp::Importer importer;
     scene = importer.ReadFile(path,
         aiProcess_Triangulate |
+        aiProcess_JoinIdenticalVertices |
         aiProcess_FlipUVs |
         aiProcess_CalcTangentSpace |
         aiProcess_GenSmoothNormals);
@@ -81,50 +320,110 @@ Model::Model(const std::string& path) {
         return;
     }
 
-    // Process all meshes in the model
-    processNode(scene->mRootNode, scene);
+    // Gather all meshes in the model, merged per material
+    std::map<unsigned int, MeshData> materialMap;
+    processNode(scene->mRootNode, scene, materialMap);
+
+    // Their bone IDs would wrap in PackedVertex and bind vertices to the wrong bones
+    if (tooManyBones) {
+        std::cerr << "Refusing " << path << ": more than the " << MAX_SKIN_BONES << " bones a vertex can address" << std::endl;
+        return;
+    }
+
+    for (auto& entry : materialMap) {
+        MeshData& material = entry.second;
+        for (const auto& vertex : material.vertices) {
+            boundingRadius = std::max(boundingRadius, glm::length(vertex.position));
+        }
+
+        // Reorder for the post-transform cache and vertex fetch once everything is merged
+        MeshOptimizeReport report = optimizeMesh(material.vertices, material.indices, SORT_CLUSTERS_FOR_OVERDRAW);
+        std::cout << "Optimized material " << entry.first << " of " << path << ": ACMR "
+                  << report.acmrBefore << " -> " << report.acmrAfter << std::endl;
+
+        if (scene->mNumMaterials > entry.first) {
+            aiMaterial* aiMat = scene->mMaterials[entry.first];
+
+            // Load diffuse textures
+            auto diffuseMaps = loadMaterialTextures(aiMat, aiTextureType_DIFFUSE, "texture_diffuse");
+            material.textures.insert(material.textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+
+            // Load specular textures
+            auto specularMaps = loadMaterialTextures(aiMat, aiTextureType_SPECULAR, "texture_specular");
+            material.textures.insert(material.textures.end(), specularMaps.begin(), specularMaps.end());
+        }
+
+        pendingMaterials.push_back(std::move(material));
+    }
     
+    // Skinned meshes get a skeleton even without clips of their own, so clips
+    // imported separately can be played on them
+    if (scene->mRootNode && (!boneInfoMap.empty() || detectAnimations(scene))) {
+        skeleton = std::make_shared<const Skeleton>(buildSkeleton(scene->mRootNode, boneInfoMap));
+    }
+
     // Detect if model has animations
-    isAnimated = detectAnimations(scene);
+    isAnimated = skeleton && detectAnimations(scene);
     
     // Load animations if the model is animated
     if (isAnimated) {
         loadAnimations(scene);
-        animator = std::make_unique<Animator>();
-        
-        // Configure bone mapping for the animator
-        for (const auto& boneInfo : boneInfoMap) {
-            animator->setBoneMapping(boneInfo.first, boneInfo.second.id, boneInfo.second.offset);
-        }
-        
-        // Build node hierarchy for proper bone transformations
-        if (scene->mRootNode) {
-            animator->buildNodeHierarchy(scene->mRootNode, glm::mat4(1.0f));
-        }
+        animator = std::make_unique<Animator>(skeleton);
         
         // Auto-play the first animation if available
         autoPlayAnimation();
         
     }
+
+    if (uploadNow) {
+        upload();
+    }
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene) {
+void Model::upload() {
+    if (mesh || pendingMaterials.empty())
+        return;
+
+    // Shared process-wide, so other models using these images reuse their upload
+    for (auto& material : pendingMaterials) {
+        for (auto& texture : material.textures) {
+            texture.handle = TextureManager::instance().acquire(texture.path, &textureBytesShared);
+        }
+    }
+    mesh = std::make_unique<Mesh>(pendingMaterials, geometryStats);
+    pendingMaterials.clear();
+
+    std::cout << "Loaded " << path << ": " << mesh->drawCallCount() << " draw calls, "
+              << geometryStats.vertexCount << " vertices, "
+              << geometryStats.vertexCount * sizeof(PackedVertex) / 1024 << " KB of vertex data ("
+              << geometryStats.vertexCount * (sizeof(Vertex) - sizeof(PackedVertex)) / 1024 << " KB saved by packing), "
+              << geometryStats.indexBytes / 1024 << " KB of index data ("
+              << geometryStats.indexBytesSaved / 1024 << " KB saved by 16-bit indices), "
+              << textureBytesShared / 1024 << " KB of texture VRAM shared with earlier loads, "
+              << "max normal error " << geometryStats.maxNormalError << " deg, "
+              << "max weight error " << geometryStats.maxWeightError << std::endl;
+}
+
+void Model::requestTextureDetail(float screenPixels) const {
+    if (mesh)
+        mesh->requestTextureDetail(screenPixels);
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, std::map<unsigned int, MeshData>& materials) {
     // Process all meshes in the current node
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        processMesh(mesh, materials[mesh->mMaterialIndex]);
     }
 
     // Process all child nodes recursively
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, materials);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
+void Model::processMesh(aiMesh* mesh, MeshData& material) {
     std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
 
     // Process vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -167,11 +466,12 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
         vertices.push_back(vertex);
     }
 
-    // Process indices
+    // Process indices, offset past the vertices already merged into this material
+    unsigned int baseVertex = static_cast<unsigned int>(material.vertices.size());
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
         aiFace face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
+            material.indices.push_back(baseVertex + face.mIndices[j]);
         }
     }
     
@@ -179,42 +479,87 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
     if (mesh->HasBones()) {
         extractBoneWeightForVertices(vertices, mesh);
     }
-    
-    // Process material textures
-    if (mesh->mMaterialIndex >= 0) {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        
-        // Load diffuse textures
-        auto diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        
-        // Load specular textures
-        auto specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-    }
 
-    return Mesh(vertices, indices, textures);
+    material.vertices.insert(material.vertices.end(), vertices.begin(), vertices.end());
 }
 
 void Model::draw(GLuint shaderProgram) {
     // Set animation data in shader if model is animated
     if (isAnimated && animator && animator->isPlaying()) {
-        auto transforms = animator->getFinalBoneMatrices();
-        for (unsigned int i = 0; i < transforms.size(); i++) {
-            std::string name = "finalBonesMatrices[" + std::to_string(i) + "]";
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, GL_FALSE, glm::value_ptr(transforms[i]));
-        }
-        glUniform1i(glGetUniformLocation(shaderProgram, "hasAnimation"), 1);
+        bindBonePalette(shaderProgram, *animator);
     } else {
         glUniform1i(glGetUniformLocation(shaderProgram, "hasAnimation"), 0);
     }
 
-    // Draw all meshes
-    for (auto& mesh : meshes) {
-        mesh.draw(shaderProgram);
+    // Draw every material range of the merged mesh
+    if (mesh) {
+        mesh->draw(shaderProgram);
+    }
+}
+
+void Model::draw(GLuint shaderProgram, const Animator& pose) {
+    bindBonePalette(shaderProgram, pose);
+    if (mesh) {
+        mesh->draw(shaderProgram);
+    }
+}
+
+void Model::drawInstanced(GLuint shaderProgram, GLuint instanceBuffer, GLsizei instanceCount) {
+    if (mesh && instanceCount > 0) {
+        mesh->drawInstanced(shaderProgram, instanceBuffer, instanceCount);
     }
 }
 
+std::unique_ptr<Animator> Model::createAnimator() const {
+    if (!skeleton)
+        return nullptr;
+    auto created = std::make_unique<Animator>(skeleton);
+    created->setSkinningMode(skinningMode);
+    return created;
+}
+
+void Model::bindBonePalette(GLuint shaderProgram, const Animator& pose) {
+    glUniform1i(glGetUniformLocation(shaderProgram, "hasAnimation"), 1);
+
+    bool dualQuaternion = skinningMode == SkinningMode::DualQuaternion
+                       && pose.getSkinningMode() == SkinningMode::DualQuaternion;
+    glUniform1i(glGetUniformLocation(shaderProgram, "dualQuaternionSkinning"), dualQuaternion);
+
+    // Only the skeleton's bones are sent: two texels each as dual quaternions,
+    // three rows each as matrices, the fourth being always 0 0 0 1
+    const std::vector<glm::vec4>* texels = &pose.getBoneDualQuaternions();
+    if (!dualQuaternion) {
+        const auto& matrices = pose.getFinalBoneMatrices();
+        paletteTexels.resize(matrices.size() * 3);
+        for (size_t bone = 0; bone < matrices.size(); bone++) {
+            Affine3x4 rows = toAffine(matrices[bone]);
+            for (int row = 0; row < 3; row++)
+                paletteTexels[bone * 3 + row] = rows.rows[row];
+        }
+        texels = &paletteTexels;
+    }
+    if (texels->empty())
+        return;
+
+    if (!paletteBuffer) {
+        paletteBuffer = GLBuffer::create();
+        paletteTexture = GLTexture::create();
+        glBindTexture(GL_TEXTURE_BUFFER, paletteTexture.get());
+        glBindBuffer(GL_TEXTURE_BUFFER, paletteBuffer.get());
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, paletteBuffer.get());
+    }
+
+    // Respecifying the store lets the driver orphan the one an earlier draw still reads
+    glBindBuffer(GL_TEXTURE_BUFFER, paletteBuffer.get());
+    glBufferData(GL_TEXTURE_BUFFER, texels->size() * sizeof(glm::vec4), texels->data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture.get());
+    glUniform1i(glGetUniformLocation(shaderProgram, "bonePalette"), 1);
+    glActiveTexture(GL_TEXTURE0);
+}
+
 void Model::update(float deltaTime) {
     // Update animation if model is animated and has an active animation
     if (isAnimated && animator && animator->isPlaying()) {
@@ -223,36 +568,8 @@ void Model::update(float deltaTime) {
 }
 
 unsigned int TextureFromFile(const char* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format = GL_RGB;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    } else {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // Decoding and mip generation happen on worker threads, the upload is streamed
+    return TextureLoader::instance().loadAsync(path);
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName) {
@@ -262,67 +579,54 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
         aiString str;
         mat->GetTexture(type, i, &str);
         
-        // Check if texture was loaded before
-        bool skip = false;
-        for (const auto& loadedTex : textures_loaded) {
-            if (std::strcmp(loadedTex.path.data(), str.C_Str()) == 0) {
-                textures.push_back(loadedTex);
-                skip = true;
+        Texture texture;
+        
+        // Try different paths to find the texture
+        std::string textureRelativePath = std::string(str.C_Str());
+        std::filesystem::path fullPath = std::filesystem::path(directory) / textureRelativePath;
+        std::filesystem::path filenamePath = std::filesystem::path(directory) / std::filesystem::path(textureRelativePath).filename();
+        
+        // Try different locations
+        std::vector<std::filesystem::path> candidates = {
+            fullPath,
+            filenamePath,
+            std::filesystem::path(directory) / "textures" / std::filesystem::path(textureRelativePath).filename()
+        };
+        
+        std::filesystem::path finalPath;
+        for (const auto& candidate : candidates) {
+            if (std::filesystem::exists(candidate)) {
+                finalPath = candidate;
                 break;
             }
         }
         
-        if (!skip) {
-            Texture texture;
+        // If texture not found, try to find a texture with similar name
+        if (finalPath.empty()) {
+            std::string filename = std::filesystem::path(textureRelativePath).filename().string();
+            std::string filenameBase = filename.substr(0, filename.find_last_of('.'));
             
-            // Try different paths to find the texture
-            std::string textureRelativePath = std::string(str.C_Str());
-            std::filesystem::path fullPath = std::filesystem::path(directory) / textureRelativePath;
-            std::filesystem::path filenamePath = std::filesystem::path(directory) / std::filesystem::path(textureRelativePath).filename();
-            
-            // Try different locations
-            std::vector<std::filesystem::path> candidates = {
-                fullPath,
-                filenamePath,
-                std::filesystem::path(directory) / "textures" / std::filesystem::path(textureRelativePath).filename()
-            };
-            
-            std::filesystem::path finalPath;
-            for (const auto& candidate : candidates) {
-                if (std::filesystem::exists(candidate)) {
-                    finalPath = candidate;
-                    break;
-                }
-            }
-            
-            // If texture not found, try to find a texture with similar name
-            if (finalPath.empty()) {
-                std::string filename = std::filesystem::path(textureRelativePath).filename().string();
-                std::string filenameBase = filename.substr(0, filename.find_last_of('.'));
-                
-                for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-                    if (entry.is_regular_file()) {
-                        std::string entryName = entry.path().filename().string();
-                        if (entryName.find(filenameBase) != std::string::npos) {
-                            finalPath = entry.path();
-                            break;
-                        }
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+                if (entry.is_regular_file()) {
+                    std::string entryName = entry.path().filename().string();
+                    if (entryName.find(filenameBase) != std::string::npos) {
+                        finalPath = entry.path();
+                        break;
                     }
                 }
             }
-            
-            // If texture still not found, use a default texture or continue
-            if (finalPath.empty()) {
-                std::cerr << "Texture not found: " << textureRelativePath << std::endl;
-                continue;
-            }
-            
-            texture.id = TextureFromFile(finalPath.string().c_str());
-            texture.type = typeName;
-            texture.path = finalPath.string();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
         }
+        
+        // If texture still not found, use a default texture or continue
+        if (finalPath.empty()) {
+            std::cerr << "Texture not found: " << textureRelativePath << std::endl;
+            continue;
+        }
+        
+        // Only resolved here; upload() acquires the shared texture
+        texture.type = typeName;
+        texture.path = finalPath.string();
+        textures.push_back(texture);
     }
     
     return textures;
@@ -345,12 +649,17 @@ void Model::extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh*
         // Get or create bone ID
         int boneID = 0;
         if (boneInfoMap.find(boneName) == boneInfoMap.end()) {
+            if (boneCounter == MAX_SKIN_BONES) {
+                tooManyBones = true;
+                return;
+            }
             BoneInfo newBoneInfo;
             newBoneInfo.id = boneCounter;
             newBoneInfo.offset = glm::transpose(glm::make_mat4(&bone->mOffsetMatrix.a1));
             boneInfoMap[boneName] = newBoneInfo;
             boneID = boneCounter;
             boneCounter++;
+
         } else {
             boneID = boneInfoMap[boneName].id;
         }
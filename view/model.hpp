@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include <string>
 #include <glm/glm.hpp>
 #include <glad/glad.hpp>
@@ -7,6 +8,8 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "animation/animation.hpp"
+#include "texture_manager.hpp"
+#include "gl_resource.hpp"
 #include <memory>
 #include <filesystem>
 #include <iostream>
@@ -20,55 +23,165 @@ struct Vertex {
     float weights[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 };
 
+// Bones addressable by PackedVertex::boneIDs; skins with more are refused
+constexpr int MAX_SKIN_BONES = 65536;
+
+// GPU vertex layout, 32 bytes instead of the 80 of Vertex
+struct PackedVertex {
+    glm::vec3 position;
+    uint32_t normal;       // GL_INT_2_10_10_10_REV, signed normalized
+    uint32_t texCoords;    // two half floats
+    uint16_t boneIDs[4];   // unused slots point at bone 0 with a zero weight
+    uint8_t weights[4];    // unorm8, always summing to 255 on skinned vertices
+};
+
+// Geometry footprint of a model, accumulated while its meshes are uploaded
+struct GeometryStats {
+    size_t vertexCount = 0;
+    size_t indexBytes = 0;
+    size_t indexBytesSaved = 0;
+    float maxNormalError = 0.0f;   // degrees
+    float maxWeightError = 0.0f;
+};
+
 struct Texture {
-    unsigned int id;
+    TextureHandle handle;
     std::string type;
     std::string path;
 };
 
+// Geometry of every imported mesh sharing one material, before upload
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Texture> textures;
+};
+
+// Draw range of one material inside the shared buffers of a Mesh
+struct SubMesh {
+    std::vector<Texture> textures;
+    unsigned int indexCount;
+    GLenum indexType;
+    size_t indexOffset;   // bytes into the element buffer
+    GLint baseVertex;
+};
+
+// Per-instance attributes of an instanced draw
+struct InstanceData {
+    glm::mat4 transform;
+    glm::vec4 animation;   // baked clip first row, frame count, frames per second, time offset
+};
+
+// All geometry of a model in one VAO, drawn with one call per material.
+// Owns its GL objects, so it can be moved but not copied
 class Mesh {
 public:
-    Mesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<Texture>& textures);
+    Mesh(std::vector<MeshData>& materials, GeometryStats& stats);
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
     void draw(GLuint shaderProgram);
+    // Draws instanceCount copies, each reading one InstanceData from instanceBuffer
+    void drawInstanced(GLuint shaderProgram, GLuint instanceBuffer, GLsizei instanceCount);
+    size_t drawCallCount() const { return subMeshes.size(); }
+    // Forwards a texture detail request for the on-screen size of the mesh
+    void requestTextureDetail(float screenPixels) const;
+    // Largest distance between vertices skinned under the pose from the
+    // imported and from the packed layout, over about sampleCount of them.
+    // Reads the imported geometry, so only before upload()
+    float packingError(const Animator& pose, size_t sampleCount) const;
 private:
-    GLuint VAO, VBO, EBO;
-    std::vector<Texture> textures;
-    unsigned int indexCount;
-    void setupMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+    GLVertexArray instancedVAO;
+    GLuint boundInstanceBuffer = 0;
+    std::vector<SubMesh> subMeshes;
+    void setupMesh(std::vector<MeshData>& materials, GeometryStats& stats);
+    void bindVertexAttributes() const;
 };
 
 class Model {
 public:
-    Model(const std::string& path);
+    // Imports the file on the calling thread. With uploadNow false no GL call
+    // is made, so a model can be imported in the background and upload()ed later
+    Model(const std::string& path, bool uploadNow = true);
+    // Creates the GPU buffers and acquires the textures, on the GL thread
+    void upload();
+    bool isUploaded() const { return mesh != nullptr; }
+    bool hasGeometry() const { return mesh || !pendingMaterials.empty(); }
+    const std::string& getPath() const { return path; }
+
     void draw(GLuint shaderProgram);
+    // Draws the mesh posed by an animator created from this model
+    void draw(GLuint shaderProgram, const Animator& pose);
+    void drawInstanced(GLuint shaderProgram, GLuint instanceBuffer, GLsizei instanceCount);
     void update(float deltaTime);
     bool hasAnimation() const { return isAnimated; }
+    bool hasSkeleton() const { return skeleton != nullptr; }
+    const std::shared_ptr<const Skeleton>& getSkeleton() const { return skeleton; }
+    // A fresh instance of the skeleton, null for unskinned models. Every
+    // animator poses the same mesh, so one model serves many characters
+    std::unique_ptr<Animator> createAnimator() const;
+    // Applies to animators created afterwards; one created before keeps
+    // drawing with linear blending
+    void setSkinningMode(SkinningMode mode) { skinningMode = mode; }
+    SkinningMode getSkinningMode() const { return skinningMode; }
+    // Model-space radius of the bind pose around its origin
+    float getBoundingRadius() const { return boundingRadius; }
+    // Vertex and index buffer bytes owned by this model
+    size_t gpuBytes() const { return geometryStats.vertexCount * sizeof(PackedVertex) + geometryStats.indexBytes; }
+    void requestTextureDetail(float screenPixels) const;
+    // Largest distance between vertices skinned under the pose from the
+    // imported and from the packed layout, over about sampleCount of them.
+    // Reads the imported geometry, so only before upload()
+    float packingError(const Animator& pose, size_t sampleCount) const;
 
 private:
-    std::vector<Mesh> meshes;
+    std::unique_ptr<Mesh> mesh;
+    std::vector<MeshData> pendingMaterials;   // imported, waiting for upload()
+    std::string path;
     std::string directory;   
-    std::vector<Texture> textures_loaded;
+    size_t textureBytesShared = 0;
+    GeometryStats geometryStats;
+    float boundingRadius = 0.0f;
     
     // Animation-related members
     std::map<std::string, BoneInfo> boneInfoMap;
     int boneCounter = 0;
+    bool tooManyBones = false;
     std::vector<Animation> animations;
+    std::shared_ptr<const Skeleton> skeleton;
     std::unique_ptr<Animator> animator;
+    SkinningMode skinningMode = SkinningMode::Linear;
     const aiScene* scene = nullptr;
+
+    // Bone palette of the pose being drawn: three texels of matrix rows, or
+    // two of dual quaternion, per bone. Rewritten by every animated draw
+    GLBuffer paletteBuffer;
+    GLTexture paletteTexture;
+    std::vector<glm::vec4> paletteTexels;
     bool isAnimated = false;
     
     // Processing methods
-    void processNode(aiNode* node, const aiScene* scene);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    void processNode(aiNode* node, const aiScene* scene, std::map<unsigned int, MeshData>& materials);
+    void processMesh(aiMesh* mesh, MeshData& material);
     std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
     
     // Animation-related methods
     void extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh);
     void loadAnimations(const aiScene* scene);
     void autoPlayAnimation();
+    // Uploads the pose's palette to the texture buffer read by the vertex shader
+    void bindBonePalette(GLuint shaderProgram, const Animator& pose);
     bool detectAnimations(const aiScene* scene);
 };
 
 // Utility function for texture loading
 unsigned int TextureFromFile(const char* path);
 
+// Quantizes an imported vertex to the GPU layout, tracking the precision lost
+PackedVertex packVertex(const Vertex& vertex, GeometryStats& stats);
+
+// Offline check: skinning error of the packed vertex layout on a model posed
+// through a clip, printed per sampled time; false when it exceeds the tolerance
+bool checkVertexPacking(const std::string& modelPath, const std::string& clipPath);
+
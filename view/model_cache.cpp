@@ -0,0 +1,116 @@
+#include "model_cache.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+#include <iostream>
+
+namespace {
+
+std::string resolvePath(const std::string& path) {
+    std::error_code error;
+    std::string resolved = std::filesystem::weakly_canonical(path, error).string();
+    return error ? path : resolved;
+}
+
+}
+
+ModelCache& ModelCache::instance() {
+    static ModelCache cache;
+    return cache;
+}
+
+// Textures are released by cached models, so the texture manager must outlive this cache
+ModelCache::ModelCache() {
+    TextureManager::instance();
+}
+
+std::shared_ptr<Model> ModelCache::acquire(const std::string& path) {
+    std::string resolved = resolvePath(path);
+
+    auto it = models.find(resolved);
+    if (it == models.end()) {
+        CachedModel cached;
+        cached.model = std::make_shared<Model>(path);
+        cached.bytes = cached.model->gpuBytes();
+        it = models.emplace(resolved, std::move(cached)).first;
+    }
+    it->second.lastUsed = ++useCounter;
+    return it->second.model;
+}
+
+bool ModelCache::contains(const std::string& path) const {
+    return models.find(resolvePath(path)) != models.end();
+}
+
+std::shared_ptr<Model> ModelCache::adopt(const std::string& path, std::shared_ptr<Model> model) {
+    std::string resolved = resolvePath(path);
+
+    auto it = models.find(resolved);
+    if (it == models.end()) {
+        CachedModel cached;
+        model->upload();
+        cached.model = std::move(model);
+        cached.bytes = cached.model->gpuBytes();
+        it = models.emplace(resolved, std::move(cached)).first;
+    }
+    it->second.lastUsed = ++useCounter;
+
+    // Preloaded skins arrive with no other holder, so older unused models make room
+    // for them here; the reference held meanwhile keeps this one from going first
+    std::shared_ptr<Model> adopted = it->second.model;
+    trim();
+    return adopted;
+}
+
+bool ModelCache::replace(const std::string& path, Model&& model) {
+    auto it = models.find(resolvePath(path));
+    if (it == models.end())
+        return false;
+
+    // The old GPU buffers are freed by the move, and every holder sees the new content
+    model.upload();
+    *it->second.model = std::move(model);
+    it->second.bytes = it->second.model->gpuBytes();
+    return true;
+}
+
+void ModelCache::unload(const std::string& path) {
+    std::string resolved = resolvePath(path);
+    models.erase(resolved);
+}
+
+void ModelCache::trim() {
+    size_t resident = residentBytes();
+    if (resident <= budgetBytes)
+        return;
+
+    // Only the cache holds unused models
+    std::vector<std::unordered_map<std::string, CachedModel>::iterator> unused;
+    for (auto it = models.begin(); it != models.end(); ++it) {
+        if (it->second.model.use_count() == 1)
+            unused.push_back(it);
+    }
+    std::sort(unused.begin(), unused.end(), [](const auto& a, const auto& b) {
+        return a->second.lastUsed < b->second.lastUsed;
+    });
+
+    for (auto it : unused) {
+        if (resident <= budgetBytes)
+            break;
+        std::cout << "Evicting model " << it->first << " (" << it->second.bytes / 1024 << " KB)" << std::endl;
+        resident -= it->second.bytes;
+        models.erase(it);
+    }
+}
+
+void ModelCache::clear() {
+    models.clear();
+    TextureManager::instance().unloadUnused();
+}
+
+size_t ModelCache::residentBytes() const {
+    size_t total = 0;
+    for (const auto& pair : models)
+        total += pair.second.bytes;
+    return total;
+}
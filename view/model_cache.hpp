@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include "model.hpp"
+
+// Process-wide cache of loaded models. Callers share one Model per path
+// through shared_ptr; the cache keeps its own reference so a model nobody
+// draws any more stays loaded until its memory is needed, then the least
+// recently used ones are freed first
+class ModelCache {
+public:
+    static ModelCache& instance();
+
+    std::shared_ptr<Model> acquire(const std::string& path);
+
+    bool contains(const std::string& path) const;
+
+    // Caches a model imported elsewhere, uploading it if needed, then trims to
+    // the budget. A model already cached for the path wins and is returned instead
+    std::shared_ptr<Model> adopt(const std::string& path, std::shared_ptr<Model> model);
+
+    // Swaps a re-imported model into the cached one in place, on the GL thread
+    bool replace(const std::string& path, Model&& model);
+
+    // Drops the cache's reference; the model is freed once its last user lets go
+    void unload(const std::string& path);
+
+    // Frees unused models until the cached geometry fits the budget
+    void trim();
+
+    // Drops every cached model and unused texture, before the GL context goes away
+    void clear();
+
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    size_t residentBytes() const;
+    size_t modelCount() const { return models.size(); }
+
+private:
+    ModelCache();
+
+    struct CachedModel {
+        std::shared_ptr<Model> model;
+        size_t bytes = 0;
+        uint64_t lastUsed = 0;
+    };
+
+    std::unordered_map<std::string, CachedModel> models;
+    size_t budgetBytes = 128 * 1024 * 1024;
+    uint64_t useCounter = 0;
+};
@@ -1,5 +1,8 @@
 #include "renderer.hpp"
 #include "shader.hpp"
+#include "texture_loader.hpp"
+#include "model_cache.hpp"
+#include "animation/animation_system.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
@@ -10,18 +13,34 @@ Renderer::Renderer(unsigned int width, unsigned int height, std::shared_ptr<Game
 {
 }
 
-Renderer::~Renderer() {}
+Renderer::~Renderer() {
+    hotReloader.reset();
+    character.reset();
+    crowd.reset();
+    model.reset();
+    staticModel.reset();
+    SkinRegistry::instance().clear();
+    ModelCache::instance().clear();
+    glDeleteProgram(shaderProgram);
+    glDeleteProgram(hudShader);
+    glDeleteProgram(crowdShader);
+}
 
 bool Renderer::initialize() {
     // Create shader programs using the improved shader sources
     shaderProgram = createShaderProgram(improvedVertexShaderSrc, improvedFragmentShaderSrc);
     hudShader = createShaderProgram(improvedHudVertexShaderSrc, improvedFragmentShaderSrc);
+    crowdShader = createShaderProgram(crowdVertexShaderSrc, improvedFragmentShaderSrc);
     
-    if (!shaderProgram || !hudShader) {
+    if (!shaderProgram || !hudShader || !crowdShader) {
         std::cerr << "Error: Could not create shader programs" << std::endl;
         return false;
     }
 
+    // The bone palette sampler stays off unit 0, where a 2D texture is bound even for static draws
+    glUseProgram(shaderProgram);
+    glUniform1i(glGetUniformLocation(shaderProgram, "bonePalette"), 1);
+
     // Disable face culling to see both sides
     glDisable(GL_CULL_FACE);
     
@@ -30,11 +49,13 @@ bool Renderer::initialize() {
 
     // Load both static and animated models
     try {
-        // Load the static model
-        staticModel = std::make_unique<Model>("view/resources/skins/men/yahya/everyday.fbx");
+        // Skins load on demand; only the fallback is loaded up front
+        SkinRegistry::instance().scan();
+        SkinRegistry::instance().setFallback("men/yahya/everyday");
+        setSkin(staticSkin);
         
-        // Load the animated model
-        model = std::make_unique<Model>("view/resources/skins/men/yahya/animations/everyday_idle.fbx");
+        // The animated character shares the skin's mesh; its clips are imported without geometry
+        model = SkinRegistry::instance().get("men/yahya/everyday");
         
         // Initialize text rendering
         initialiseGLText();
@@ -49,11 +70,39 @@ bool Renderer::initialize() {
 void Renderer::render(GLFWwindow* window) {
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // Update animation if present
-    if (model && model->hasAnimation()) {
+
+    // Swap in assets reloaded since the last frame, before anything is drawn
+    if (hotReloader) {
+        hotReloader->update();
+    }
+
+    // Upload skins imported in the background, then pick up the current one
+    SkinRegistry::instance().update();
+    staticModel = SkinRegistry::instance().get(staticSkin);
+
+    // A new character mesh, a reload of it or another skinning mode needs a new animator
+    if (model && model->hasSkeleton()) {
+        model->setSkinningMode(characterSkinning);
+    }
+    if (model && model->hasSkeleton() &&
+        (!character || &character->getAnimator().getSkeleton() != model->getSkeleton().get()
+                    || character->getAnimator().getSkinningMode() != characterSkinning)) {
+        character = std::make_unique<CharacterAnimation>(model->createAnimator(),
+            "view/resources/skins/men/yahya/animations/everyday_");
+    }
+
+    // Every character animates on the workers while this thread gets on with the frame
+    if (character) {
+        character->update(controller->getLocomotion(), controller->getMoveDirection(), controller->isFiring());
+        character->setPosition(controller->getCameraPos() + glm::vec3(0.0f, -1.01f, 3.0f));
+    } else if (model && model->hasAnimation()) {
         model->update(controller->getDeltaTime());
     }
+    AnimationSystem::instance().setViewPosition(controller->getCameraPos());
+    AnimationSystem::instance().begin(controller->getDeltaTime());
+
+    // Stream textures decoded in the background since the last frame
+    TextureLoader::instance().processUploads();
     
     // Create view and projection matrices
     glm::mat4 view = glm::lookAt(
@@ -74,6 +123,9 @@ void Renderer::render(GLFWwindow* window) {
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
     
+    // Bone palettes must be complete before the first skinned draw
+    AnimationSystem::instance().finish();
+
     // Draw the animated model
     if (model) {
         glm::mat4 characterModelMat = glm::mat4(1.0f);
@@ -86,9 +138,23 @@ void Renderer::render(GLFWwindow* window) {
         characterModelMat = glm::rotate(characterModelMat, glm::radians(0.0f), glm::vec3(1, 0, 0));
         characterModelMat = glm::scale(characterModelMat, glm::vec3(0.006f));
 
+        // The clips' root motion, turned and scaled to the world, drives the player's
+        // movement next frame. Clips in place leave the controller on its own speeds
+        if (character) {
+            glm::vec3 motion = glm::mat3(characterModelMat) * character->takeRootMotion();
+            if (character->hasRootMotion()) {
+                controller->setRootMotion(motion);
+            }
+        }
+
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &characterModelMat[0][0]);
         glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
-        model->draw(shaderProgram);
+        model->requestTextureDetail(projectedPixels(*model, characterModelMat));
+        if (character) {
+            model->draw(shaderProgram, character->getAnimator());
+        } else {
+            model->draw(shaderProgram);
+        }
     }
     
     // Draw the static model (offset to the side)
@@ -105,8 +171,21 @@ void Renderer::render(GLFWwindow* window) {
 
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &staticModelMat[0][0]);
         glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
+        staticModel->requestTextureDetail(projectedPixels(*staticModel, staticModelMat));
         staticModel->draw(shaderProgram);
     }
+
+    // The whole crowd in one instanced draw per material
+    if (crowd && crowd->size() > 0) {
+        glUseProgram(crowdShader);
+        glUniformMatrix4fv(glGetUniformLocation(crowdShader, "view"), 1, GL_FALSE, &view[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(crowdShader, "projection"), 1, GL_FALSE, &projection[0][0]);
+        crowd->draw(crowdShader, static_cast<float>(glfwGetTime()));
+        glUseProgram(shaderProgram);
+    }
+
+    // Load or drop texture mips for what was drawn this frame
+    TextureManager::instance().updateStreaming();
     
     // Draw environment
     glm::mat4 platformModelMat = glm::mat4(1.0f);
@@ -119,6 +198,15 @@ void Renderer::render(GLFWwindow* window) {
     drawHUD(window);
 }
 
+// Height in pixels of the model's bounding sphere, the most texels it can show on screen
+float Renderer::projectedPixels(const Model& target, const glm::mat4& modelMat) const {
+    float scale = glm::length(glm::vec3(modelMat[0]));
+    float radius = target.getBoundingRadius() * scale;
+    float distance = std::max(glm::length(glm::vec3(modelMat[3]) - controller->getCameraPos()), 0.1f);
+    float halfHeight = distance * std::tan(glm::radians(45.0f) / 2.0f);
+    return radius / halfHeight * screenHeight;
+}
+
 void Renderer::drawLine(GLuint shader, glm::vec3 start, glm::vec3 end, glm::vec3 color) {
     float vertices[] = {
         start.x, start.y, start.z,
@@ -362,12 +450,63 @@ void Renderer::drawWalls() {
 void Renderer::loadModel(const std::string& path, bool isAnimated) {
     try {
         if (isAnimated) {
-            model = std::make_unique<Model>(path);
+            // The animator is rebuilt for the new skeleton on the next frame
+            model = ModelCache::instance().acquire(path);
         } else {
-            staticModel = std::make_unique<Model>(path);
+            staticModel = ModelCache::instance().acquire(path);
         }
+        // The replaced model stays cached until its memory is needed
+        ModelCache::instance().trim();
     } catch (const std::exception& e) {
         std::cerr << "Error loading model: " << e.what() << std::endl;
     }
 }
 
+void Renderer::enableHotReload(const std::string& root) {
+    hotReloader = std::make_unique<HotReloader>(root);
+    if (!hotReloader->start()) {
+        hotReloader.reset();
+    }
+}
+
+void Renderer::setSkin(const std::string& skinId) {
+    staticSkin = skinId;
+    staticModel = SkinRegistry::instance().get(skinId);
+
+    // The skins around it in the listing are the likeliest next picks
+    SkinRegistry::instance().prefetch(SkinRegistry::instance().neighbours(skinId));
+}
+
+void Renderer::spawnCrowd(size_t count) {
+    std::shared_ptr<Model> crowdModel = SkinRegistry::instance().get("men/yahya/everyday");
+    if (!crowdModel || !crowdModel->hasSkeleton()) {
+        std::cerr << "No skinned model for the crowd" << std::endl;
+        return;
+    }
+
+    // Baked offline with --bake-animations; baking here instead only costs startup time
+    BakedAnimationSet baked;
+    if (!loadBakedAnimations(crowdModel->getSkeleton(), crowdModel->getPath(), {"idle", "walking"}, baked)) {
+        std::cerr << "No animations for the crowd" << std::endl;
+        return;
+    }
+
+    crowd = std::make_unique<Crowd>(crowdModel, baked);
+    if (!crowd->isValid()) {
+        crowd.reset();
+        return;
+    }
+
+    // Rows of spectators on the platform, out of step with each other
+    size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float spacing = 1.2f;
+    for (size_t i = 0; i < count; i++) {
+        float x = (static_cast<float>(i % columns) - columns / 2.0f) * spacing;
+        float z = (static_cast<float>(i / columns) - columns / 2.0f) * spacing;
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+        transform = glm::rotate(transform, glm::radians(static_cast<float>((i * 47) % 360)), glm::vec3(0, 1, 0));
+        transform = glm::scale(transform, glm::vec3(0.006f));
+        crowd->add(transform, i % 3 == 0 ? "walking" : "idle", static_cast<float>(i % 17) * 0.37f);
+    }
+    std::cout << "Spawned a crowd of " << crowd->size() << " characters" << std::endl;
+}
@@ -11,20 +11,34 @@
 #define GLT_IMPLEMENTATION
 #include "resources/gltext.hpp"
 #include "model.hpp"
+#include "hot_reload.hpp"
+#include "skin_registry.hpp"
+#include "animation/character_animation.hpp"
+#include "crowd.hpp"
 
 class Renderer {
 private:
     std::shared_ptr<GameController> controller;
     
-    GLuint shaderProgram;
-    GLuint hudShader;
+    GLuint shaderProgram = 0;
+    GLuint hudShader = 0;
+    GLuint crowdShader = 0;
 
     GLTtext* glTextLabel;
     GLTtext* glTextTimer;
     std::unique_ptr<GLTtext> healthText;
 
-    std::unique_ptr<Model> model;
-    std::unique_ptr<Model> staticModel;
+    std::shared_ptr<Model> model;
+    std::shared_ptr<Model> staticModel;
+    // Poses the animated character's mesh from the player's movement and firing
+    std::unique_ptr<CharacterAnimation> character;
+    SkinningMode characterSkinning = SkinningMode::Linear;
+    // Background characters on baked animations, only spawned on request
+    std::unique_ptr<Crowd> crowd;
+    std::string staticSkin = "men/yahya/everyday";
+
+    // Only set in development mode
+    std::unique_ptr<HotReloader> hotReloader;
 
     double countdownStartTime = 0.0;
     const double countdownDuration = 100.0; // 100 seconds countdown
@@ -38,6 +52,7 @@ private:
     void drawLine(GLuint shader, glm::vec3 start, glm::vec3 end, glm::vec3 color);
     void drawQuad(GLuint shader, glm::vec2 pos, glm::vec2 size, glm::vec3 color);
     void drawWall(GLuint shader, glm::vec3 pos, glm::vec3 size, glm::vec3 color);
+    float projectedPixels(const Model& target, const glm::mat4& modelMat) const;
     
 public:
     Renderer(unsigned int width, unsigned int height, std::shared_ptr<GameController> ctrl);
@@ -61,6 +76,18 @@ public:
     
     // Method to load a model
     void loadModel(const std::string& path, bool isAnimated);
+
+    // Shows a skin from the registry, with the fallback until it has loaded
+    void setSkin(const std::string& skinId);
+
+    // Development mode: reload assets under root as their files change
+    void enableHotReload(const std::string& root);
+
+    // Fills the arena with count characters playing baked clips
+    void spawnCrowd(size_t count);
+
+    // Vertex blending of the animated character, linear unless changed
+    void setCharacterSkinning(SkinningMode mode) { characterSkinning = mode; }
 };
 
 #endif // RENDERER_HPP
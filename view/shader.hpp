@@ -9,7 +9,7 @@ const char* improvedVertexShaderSrc = R"(
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in ivec4 aBoneIDs;
+layout (location = 3) in uvec4 aBoneIDs;
 layout (location = 4) in vec4 aWeights;
 
 uniform mat4 model;
@@ -17,31 +17,69 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform bool hasAnimation;
 
-// For animation
-uniform mat4 finalBonesMatrices[100];
+// For animation: three texels of matrix rows per bone, or with dual
+// quaternion skinning two texels, the rotation then the dual part
+uniform samplerBuffer bonePalette;
+uniform bool dualQuaternionSkinning;
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
+mat4 paletteBone(uint bone) {
+    int texel = int(bone) * 3;
+    vec4 row0 = texelFetch(bonePalette, texel);
+    vec4 row1 = texelFetch(bonePalette, texel + 1);
+    vec4 row2 = texelFetch(bonePalette, texel + 2);
+    return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
 void main() {
     TexCoords = aTexCoords;
     
     vec4 totalPosition = vec4(0.0);
     vec3 totalNormal = vec3(0.0);
     
-    if (hasAnimation) {
+    if (hasAnimation && dualQuaternionSkinning) {
+        // Blend the dual quaternions, flipping any on the far side of the first bone's rotation
+        vec4 pivot = texelFetch(bonePalette, int(aBoneIDs[0]) * 2);
+        vec4 real = vec4(0.0);
+        vec4 dual = vec4(0.0);
+        for(int i = 0; i < 4; i++) {
+            float weight = aWeights[i];
+            vec4 boneReal = texelFetch(bonePalette, int(aBoneIDs[i]) * 2);
+            if (dot(boneReal, pivot) < 0.0)
+                weight = -weight;
+            real += boneReal * weight;
+            dual += texelFetch(bonePalette, int(aBoneIDs[i]) * 2 + 1) * weight;
+        }
+
+        float len = length(real);
+        if (len == 0.0) {
+            totalPosition = vec4(aPos, 1.0);
+            totalNormal = aNormal;
+        } else {
+            real /= len;
+            dual /= len;
+            // Rotate, then translate by 2 * dual * conjugate(real)
+            vec3 rotated = aPos + 2.0 * cross(real.xyz, cross(real.xyz, aPos) + real.w * aPos);
+            vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+            totalPosition = vec4(rotated + translation, 1.0);
+            totalNormal = aNormal + 2.0 * cross(real.xyz, cross(real.xyz, aNormal) + real.w * aNormal);
+        }
+    } else if (hasAnimation) {
         // Apply bone transformations
         for(int i = 0; i < 4; i++) {
-            if(aBoneIDs[i] == -1 || aWeights[i] == 0.0) 
+            if(aWeights[i] == 0.0) 
                 continue;
                 
             // Apply bone transformation
-            vec4 localPosition = finalBonesMatrices[aBoneIDs[i]] * vec4(aPos, 1.0);
+            mat4 bone = paletteBone(aBoneIDs[i]);
+            vec4 localPosition = bone * vec4(aPos, 1.0);
             totalPosition += localPosition * aWeights[i];
             
             // Transform normal by bone matrix (ignoring translation)
-            vec3 localNormal = mat3(finalBonesMatrices[aBoneIDs[i]]) * aNormal;
+            vec3 localNormal = mat3(bone) * aNormal;
             totalNormal += localNormal * aWeights[i];
         }
         
@@ -65,6 +103,65 @@ void main() {
 }
 )";
 
+// Instanced characters posed from baked palettes: no bone uniforms, each
+// instance brings its transform and clip, and time comes from one uniform
+const char* crowdVertexShaderSrc = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uvec4 aBoneIDs;
+layout (location = 4) in vec4 aWeights;
+layout (location = 5) in mat4 aInstanceModel;
+// First row, frame count, frames per second, time offset
+layout (location = 9) in vec4 aInstanceClip;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float time;
+uniform sampler2D bakedBones;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+
+// Three texels per bone hold the first three rows of its matrix
+mat4 bakedBone(uint bone, int row) {
+    int column = int(bone) * 3;
+    vec4 row0 = texelFetch(bakedBones, ivec2(column, row), 0);
+    vec4 row1 = texelFetch(bakedBones, ivec2(column + 1, row), 0);
+    vec4 row2 = texelFetch(bakedBones, ivec2(column + 2, row), 0);
+    return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() {
+    TexCoords = aTexCoords;
+
+    // Blend the two baked frames around the instance's clip time, looping
+    float frameCount = aInstanceClip.y;
+    float frame = mod((time + aInstanceClip.w) * aInstanceClip.z, frameCount);
+    int firstRow = int(aInstanceClip.x);
+    int current = firstRow + int(frame);
+    int next = firstRow + (int(frame) + 1) % int(frameCount);
+    float blend = fract(frame);
+
+    mat4 skin = mat4(0.0);
+    for (int i = 0; i < 4; i++) {
+        if (aWeights[i] == 0.0)
+            continue;
+        mat4 currentBone = bakedBone(aBoneIDs[i], current);
+        skin += (currentBone + (bakedBone(aBoneIDs[i], next) - currentBone) * blend) * aWeights[i];
+    }
+    if (dot(aWeights, vec4(1.0)) == 0.0)
+        skin = mat4(1.0);
+
+    vec4 position = skin * vec4(aPos, 1.0);
+    gl_Position = projection * view * aInstanceModel * position;
+    Normal = mat3(aInstanceModel) * mat3(skin) * aNormal;
+    FragPos = vec3(aInstanceModel * position);
+}
+)";
+
 const char* improvedFragmentShaderSrc = R"(
 #version 330 core
 in vec2 TexCoords;
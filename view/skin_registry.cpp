@@ -0,0 +1,167 @@
+#include "skin_registry.hpp"
+#include "model_cache.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+SkinRegistry& SkinRegistry::instance() {
+    static SkinRegistry registry;
+    return registry;
+}
+
+// Models and their textures are cached elsewhere, so those caches must outlive the registry
+SkinRegistry::SkinRegistry() : worker(1) {
+    ModelCache::instance();
+}
+
+void SkinRegistry::scan(const std::string& root) {
+    skins.clear();
+    byId.clear();
+
+    std::error_code error;
+    for (const std::string gender : {"men", "women"}) {
+        for (const auto& character : std::filesystem::directory_iterator(std::filesystem::path(root) / gender, error)) {
+            if (!character.is_directory())
+                continue;
+
+            // Only the character folder itself: animation clips live in a subfolder
+            for (const auto& file : std::filesystem::directory_iterator(character.path(), error)) {
+                if (!file.is_regular_file() || file.path().extension() != ".fbx")
+                    continue;
+
+                SkinInfo skin;
+                skin.gender = gender;
+                skin.character = character.path().filename().string();
+                skin.name = file.path().stem().string();
+                skin.id = gender + "/" + skin.character + "/" + skin.name;
+                skin.modelPath = file.path().string();
+                skins.push_back(skin);
+            }
+        }
+    }
+
+    // Directory order is unspecified; a stable listing keeps neighbours() meaningful
+    std::sort(skins.begin(), skins.end(), [](const SkinInfo& a, const SkinInfo& b) { return a.id < b.id; });
+    for (size_t i = 0; i < skins.size(); i++)
+        byId[skins[i].id] = i;
+
+    std::cout << "Found " << skins.size() << " skins under " << root << std::endl;
+}
+
+const SkinInfo* SkinRegistry::find(const std::string& id) const {
+    auto it = byId.find(id);
+    return it == byId.end() ? nullptr : &skins[it->second];
+}
+
+bool SkinRegistry::setFallback(const std::string& id) {
+    const SkinInfo* skin = find(id);
+    if (!skin) {
+        std::cerr << "Unknown fallback skin: " << id << std::endl;
+        return false;
+    }
+    fallback = ModelCache::instance().acquire(skin->modelPath);
+    return true;
+}
+
+std::shared_ptr<Model> SkinRegistry::get(const std::string& id) {
+    const SkinInfo* skin = find(id);
+    if (!skin)
+        return fallback;
+
+    if (ModelCache::instance().contains(skin->modelPath))
+        return ModelCache::instance().acquire(skin->modelPath);
+
+    enqueue(id, true);
+    return fallback;
+}
+
+void SkinRegistry::prefetch(const std::vector<std::string>& ids) {
+    for (const auto& id : ids) {
+        const SkinInfo* skin = find(id);
+        if (skin && !ModelCache::instance().contains(skin->modelPath))
+            enqueue(id, false);
+    }
+}
+
+std::vector<std::string> SkinRegistry::neighbours(const std::string& id, int count) const {
+    std::vector<std::string> result;
+    auto it = byId.find(id);
+    if (it == byId.end() || skins.size() < 2)
+        return result;
+
+    int total = static_cast<int>(skins.size());
+    int index = static_cast<int>(it->second);
+    for (int step = 1; step <= count && 2 * step <= total; step++) {
+        result.push_back(skins[(index + step) % total].id);
+        if (2 * step < total)
+            result.push_back(skins[(index - step + total) % total].id);
+    }
+    return result;
+}
+
+void SkinRegistry::update() {
+    std::vector<std::pair<std::string, std::shared_ptr<Model>>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(imported);
+    }
+
+    for (auto& entry : ready) {
+        const SkinInfo* skin = find(entry.first);
+        if (skin && entry.second->hasGeometry())
+            ModelCache::instance().adopt(skin->modelPath, std::move(entry.second));
+        else
+            std::cerr << "Skin " << entry.first << " failed to load, keeping the fallback" << std::endl;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loading.erase(entry.first);
+    }
+}
+
+void SkinRegistry::clear() {
+    fallback.reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+}
+
+void SkinRegistry::enqueue(const std::string& id, bool urgent) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (loading.count(id)) {
+            // A prefetch still waiting moves ahead once the skin is actually needed
+            auto queued = std::find(queue.begin(), queue.end(), id);
+            if (urgent && queued != queue.end()) {
+                queue.erase(queued);
+                queue.push_front(id);
+            }
+            return;
+        }
+
+        loading.insert(id);
+        if (urgent)
+            queue.push_front(id);
+        else
+            queue.push_back(id);
+    }
+
+    // One job per queued skin; each takes whichever skin is most urgent when it runs
+    worker.enqueue([this] { importNext(); });
+}
+
+void SkinRegistry::importNext() {
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty())
+            return;
+        id = queue.front();
+        queue.pop_front();
+    }
+
+    // Import only: the GL upload waits for update() on the GL thread
+    auto model = std::make_shared<Model>(skins[byId.at(id)].modelPath, false);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    imported.emplace_back(id, std::move(model));
+}
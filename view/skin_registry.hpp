@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "model.hpp"
+#include "thread_pool.hpp"
+
+// One wearable character model found under the skins directory
+struct SkinInfo {
+    std::string id;          // "men/yahya/everyday"
+    std::string gender;      // "men" or "women"
+    std::string character;   // "yahya"
+    std::string name;        // "everyday"
+    std::string modelPath;
+};
+
+// Knows every skin on disk but loads none up front. A skin is imported in
+// the background the first time it is asked for, or earlier when prefetched,
+// and renders with the shared fallback skin until it is ready
+class SkinRegistry {
+public:
+    static SkinRegistry& instance();
+
+    // Lists the skins under root/{men,women}/<character>/<name>.fbx
+    void scan(const std::string& root = "view/resources/skins");
+
+    const std::vector<SkinInfo>& getSkins() const { return skins; }
+    const SkinInfo* find(const std::string& id) const;
+
+    // Loaded synchronously; stands in for every skin still loading
+    bool setFallback(const std::string& id);
+
+    // The skin's model if loaded, otherwise queues it and returns the fallback
+    std::shared_ptr<Model> get(const std::string& id);
+
+    // Loads skins likely to be needed soon, behind any skin already asked for
+    void prefetch(const std::vector<std::string>& ids);
+
+    // Skins next to id in the listing, the next ones a player cycling skins would see
+    std::vector<std::string> neighbours(const std::string& id, int count = 1) const;
+
+    // Uploads skins imported since the last frame, once per frame on the GL thread
+    void update();
+
+    // Lets go of the fallback and pending queue, before the GL context goes away
+    void clear();
+
+private:
+    SkinRegistry();
+    void enqueue(const std::string& id, bool urgent);
+    void importNext();
+
+    std::vector<SkinInfo> skins;
+    std::map<std::string, size_t> byId;
+    std::shared_ptr<Model> fallback;
+
+    // Shared with the import worker
+    std::mutex mutex;
+    std::deque<std::string> queue;   // asked-for skins at the front, prefetches behind
+    std::set<std::string> loading;   // queued or importing
+    std::vector<std::pair<std::string, std::shared_ptr<Model>>> imported;
+
+    // Declared last so the worker is joined before the queue above is destroyed
+    ThreadPool worker;
+};
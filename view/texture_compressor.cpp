@@ -0,0 +1,401 @@
+#include "texture_compressor.hpp"
+#include "texture_loader.hpp"
+#include "resources/stb_image.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const unsigned char KTX_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+struct KtxHeader {
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+uint16_t packRGB565(const float color[3]) {
+    int r = static_cast<int>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+size_t blockBytes(uint32_t internalFormat) {
+    return (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGB8_ETC2) ? 8 : 16;
+}
+
+}
+
+void encodeBC1Block(const unsigned char rgba[64], unsigned char out[8]) {
+    // Principal axis of the block colors, by a few rounds of power iteration
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += rgba[i * 4 + c] / 16.0f;
+
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++) {
+        float r = rgba[i * 4 + 0] - mean[0];
+        float g = rgba[i * 4 + 1] - mean[1];
+        float b = rgba[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max({std::abs(x), std::abs(y), std::abs(z)});
+        if (length < 1e-6f)
+            break;
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    // Endpoints are the extreme projections onto that axis
+    float minProj = 1e30f, maxProj = -1e30f;
+    int minIndex = 0, maxIndex = 0;
+    for (int i = 0; i < 16; i++) {
+        float proj = rgba[i * 4 + 0] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+        if (proj < minProj) { minProj = proj; minIndex = i; }
+        if (proj > maxProj) { maxProj = proj; maxIndex = i; }
+    }
+
+    float maxColor[3] = {float(rgba[maxIndex * 4]), float(rgba[maxIndex * 4 + 1]), float(rgba[maxIndex * 4 + 2])};
+    float minColor[3] = {float(rgba[minIndex * 4]), float(rgba[minIndex * 4 + 1]), float(rgba[minIndex * 4 + 2])};
+    uint16_t color0 = packRGB565(maxColor);
+    uint16_t color1 = packRGB565(minColor);
+
+    // color0 > color1 selects the four-color mode
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int c0[3], c1[3];
+        unpackRGB565(color0, c0);
+        unpackRGB565(color1, c1);
+
+        int palette[4][3];
+        for (int c = 0; c < 3; c++) {
+            palette[0][c] = c0[c];
+            palette[1][c] = c1[c];
+            palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+            palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = rgba[i * 4 + 0] - palette[p][0];
+                int dg = rgba[i * 4 + 1] - palette[p][1];
+                int db = rgba[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+
+    out[0] = color0 & 0xFF;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+void encodeBC3Block(const unsigned char rgba[64], unsigned char out[16]) {
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; i++) {
+        alpha0 = std::max(alpha0, int(rgba[i * 4 + 3]));
+        alpha1 = std::min(alpha1, int(rgba[i * 4 + 3]));
+    }
+
+    // alpha0 > alpha1 selects the eight-value interpolated mode
+    uint64_t indices = 0;
+    if (alpha0 > alpha1) {
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int p = 2; p < 8; p++)
+            palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; p++) {
+                int error = std::abs(rgba[i * 4 + 3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (i * 3);
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(alpha0);
+    out[1] = static_cast<unsigned char>(alpha1);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xFF;
+
+    encodeBC1Block(rgba, out + 8);
+}
+
+namespace {
+
+bool openKtx(std::ifstream& file, const std::string& path, KtxImage& image, uint32_t& levels) {
+    unsigned char identifier[12];
+    KtxHeader header;
+    file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) != 0 || header.endianness != 0x04030201) {
+        std::cerr << "Invalid KTX file: " << path << std::endl;
+        return false;
+    }
+
+    if (header.glType != 0 || header.numberOfFaces != 1 || header.pixelDepth > 1) {
+        std::cerr << "Unsupported KTX layout (only compressed 2D textures): " << path << std::endl;
+        return false;
+    }
+
+    file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    image.glInternalFormat = header.glInternalFormat;
+    image.glBaseInternalFormat = header.glBaseInternalFormat;
+    image.width = static_cast<int>(header.pixelWidth);
+    image.height = static_cast<int>(header.pixelHeight);
+    image.data.clear();
+    image.levelOffsets.clear();
+    image.levelSizes.clear();
+    levels = std::max(1u, header.numberOfMipmapLevels);
+    return true;
+}
+
+}
+
+bool readKtxHeader(const std::string& path, KtxImage& image) {
+    std::ifstream file(path, std::ios::binary);
+    uint32_t levels;
+    return file && openKtx(file, path, image, levels);
+}
+
+bool readKtx(const std::string& path, KtxImage& image, int firstLevel, int lastLevel) {
+    std::ifstream file(path, std::ios::binary);
+    uint32_t levels;
+    if (!file || !openKtx(file, path, image, levels))
+        return false;
+
+    if (lastLevel < 0 || lastLevel >= static_cast<int>(levels))
+        lastLevel = static_cast<int>(levels) - 1;
+
+    for (int level = 0; level <= lastLevel; level++) {
+        uint32_t imageSize = 0;
+        file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize));
+        // Levels are padded to 4 bytes
+        uint32_t padding = (4 - imageSize % 4) % 4;
+
+        if (level < firstLevel) {
+            file.seekg(imageSize + padding, std::ios::cur);
+            continue;
+        }
+
+        size_t offset = image.data.size();
+        image.data.resize(offset + imageSize);
+        file.read(reinterpret_cast<char*>(image.data.data() + offset), imageSize);
+        if (!file) {
+            std::cerr << "Truncated KTX file: " << path << std::endl;
+            return false;
+        }
+
+        image.levelOffsets.push_back(offset);
+        image.levelSizes.push_back(imageSize);
+        file.seekg(padding, std::ios::cur);
+    }
+
+    return true;
+}
+
+bool writeKtx(const std::string& path, const KtxImage& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot write KTX file: " << path << std::endl;
+        return false;
+    }
+
+    KtxHeader header = {};
+    header.endianness = 0x04030201;
+    header.glTypeSize = 1;
+    header.glInternalFormat = image.glInternalFormat;
+    header.glBaseInternalFormat = image.glBaseInternalFormat;
+    header.pixelWidth = static_cast<uint32_t>(image.width);
+    header.pixelHeight = static_cast<uint32_t>(image.height);
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = static_cast<uint32_t>(image.levelSizes.size());
+
+    file.write(reinterpret_cast<const char*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const char padding[3] = {0, 0, 0};
+    for (size_t level = 0; level < image.levelSizes.size(); level++) {
+        uint32_t imageSize = static_cast<uint32_t>(image.levelSizes[level]);
+        file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+        file.write(reinterpret_cast<const char*>(image.data.data() + image.levelOffsets[level]), imageSize);
+        file.write(padding, (4 - imageSize % 4) % 4);
+    }
+
+    return static_cast<bool>(file);
+}
+
+std::string cookedTexturePath(const std::string& sourcePath) {
+    return std::filesystem::path(sourcePath).replace_extension(".ktx").string();
+}
+
+bool cookTexture(const std::string& sourcePath, const std::string& ktxPath) {
+    int width, height, components;
+    unsigned char* data = stbi_load(sourcePath.c_str(), &width, &height, &components, 4);
+    if (!data) {
+        std::cerr << "Texture failed to load at path: " << sourcePath << std::endl;
+        return false;
+    }
+
+    DecodedImage source;
+    source.width = width;
+    source.height = height;
+    source.components = 4;
+    buildMipChain(source, data);
+    stbi_image_free(data);
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < static_cast<size_t>(width) * height * 4; i += 4) {
+        if (source.pixels[i] != 255) {
+            hasAlpha = true;
+            break;
+        }
+    }
+
+    KtxImage image;
+    image.glInternalFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    image.glBaseInternalFormat = hasAlpha ? 0x1908 /* GL_RGBA */ : 0x1907 /* GL_RGB */;
+    image.width = width;
+    image.height = height;
+    const size_t bytesPerBlock = blockBytes(image.glInternalFormat);
+
+    for (size_t level = 0; level < source.levelOffsets.size(); level++) {
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+        int blocksX = (w + 3) / 4;
+        int blocksY = (h + 3) / 4;
+        const unsigned char* pixels = source.pixels.data() + source.levelOffsets[level];
+
+        size_t offset = image.data.size();
+        image.levelOffsets.push_back(offset);
+        image.levelSizes.push_back(blocksX * blocksY * bytesPerBlock);
+        image.data.resize(offset + image.levelSizes.back());
+
+        for (int by = 0; by < blocksY; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                // Edge blocks of small mips repeat their last row and column
+                unsigned char block[64];
+                for (int y = 0; y < 4; y++) {
+                    for (int x = 0; x < 4; x++) {
+                        int sx = std::min(bx * 4 + x, w - 1);
+                        int sy = std::min(by * 4 + y, h - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, pixels + (sy * w + sx) * 4, 4);
+                    }
+                }
+
+                unsigned char* out = image.data.data() + offset + (by * blocksX + bx) * bytesPerBlock;
+                if (hasAlpha)
+                    encodeBC3Block(block, out);
+                else
+                    encodeBC1Block(block, out);
+            }
+        }
+    }
+
+    return writeKtx(ktxPath, image);
+}
+
+bool cookTextureDirectory(const std::string& root) {
+    using Clock = std::chrono::steady_clock;
+    size_t totalSourceBytes = 0, totalCookedBytes = 0;
+    double totalSourceMs = 0.0, totalCookedMs = 0.0;
+    bool success = true;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".png")
+            continue;
+
+        std::string sourcePath = entry.path().string();
+        std::string ktxPath = cookedTexturePath(sourcePath);
+        if (!cookTexture(sourcePath, ktxPath)) {
+            success = false;
+            continue;
+        }
+
+        // Runtime cost before: decode plus CPU mip chain, uncompressed upload
+        auto start = Clock::now();
+        DecodedImage source;
+        unsigned char* data = stbi_load(sourcePath.c_str(), &source.width, &source.height, &source.components, 0);
+        if (!data) {
+            success = false;
+            continue;
+        }
+        buildMipChain(source, data);
+        stbi_image_free(data);
+        double sourceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // Runtime cost after: read the cooked levels as they are uploaded
+        start = Clock::now();
+        KtxImage cooked;
+        readKtx(ktxPath, cooked);
+        double cookedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::cout << sourcePath << ": " << source.width << "x" << source.height << ", VRAM "
+                  << source.pixels.size() / 1024 << " KB -> " << cooked.data.size() / 1024 << " KB, load "
+                  << sourceMs << " ms -> " << cookedMs << " ms" << std::endl;
+
+        totalSourceBytes += source.pixels.size();
+        totalCookedBytes += cooked.data.size();
+        totalSourceMs += sourceMs;
+        totalCookedMs += cookedMs;
+    }
+
+    std::cout << "Total VRAM " << totalSourceBytes / (1024 * 1024) << " MB -> " << totalCookedBytes / (1024 * 1024)
+              << " MB, load " << totalSourceMs << " ms -> " << totalCookedMs << " ms" << std::endl;
+    return success;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Block-compressed formats, glad only exposes the 3.3 core enums
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT   0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT  0x83F3
+#define GL_COMPRESSED_RGB8_ETC2           0x9274
+#define GL_COMPRESSED_RGBA8_ETC2_EAC      0x9278
+
+// Contents of a KTX 1.1 file holding one 2D texture and its mip chain
+struct KtxImage {
+    uint32_t glInternalFormat = 0;
+    uint32_t glBaseInternalFormat = 0;
+    int width = 0;
+    int height = 0;
+    // Every level packed back to back, level 0 first
+    std::vector<unsigned char> data;
+    std::vector<size_t> levelOffsets;
+    std::vector<size_t> levelSizes;
+};
+
+// Reads mip levels [firstLevel, lastLevel] only, -1 meaning down to 1x1
+bool readKtx(const std::string& path, KtxImage& image, int firstLevel = 0, int lastLevel = -1);
+// Fills in format and dimensions without reading any level
+bool readKtxHeader(const std::string& path, KtxImage& image);
+bool writeKtx(const std::string& path, const KtxImage& image);
+
+// Encodes one 4x4 block of RGBA8 texels, row-major
+void encodeBC1Block(const unsigned char rgba[64], unsigned char out[8]);
+void encodeBC3Block(const unsigned char rgba[64], unsigned char out[16]);
+
+// Cooked file that replaces a source image at runtime: "skin.png" -> "skin.ktx"
+std::string cookedTexturePath(const std::string& sourcePath);
+
+// Decodes an image, builds its mips and stores them BC1 (opaque) or BC3 (alpha) encoded
+bool cookTexture(const std::string& sourcePath, const std::string& ktxPath);
+
+// Offline step: cooks every PNG under root and prints VRAM and load time
+// of the source against the cooked texture
+bool cookTextureDirectory(const std::string& root);
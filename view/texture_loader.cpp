@@ -0,0 +1,321 @@
+#include "texture_loader.hpp"
+#include "texture_compressor.hpp"
+#include "resources/stb_image.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+int TextureInfo::levelCount() const {
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+size_t TextureInfo::levelBytes(int level) const {
+    size_t w = std::max(1, width >> level);
+    size_t h = std::max(1, height >> level);
+    if (compressedFormat == 0)
+        return w * h * components;
+
+    size_t blockBytes = (compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || compressedFormat == GL_COMPRESSED_RGB8_ETC2) ? 8 : 16;
+    return ((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+}
+
+TextureLoader& TextureLoader::instance() {
+    static TextureLoader loader;
+    return loader;
+}
+
+// Two decode workers are enough to keep the PBO upload budget saturated
+TextureLoader::TextureLoader() : workers(2) {
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            hasS3TC = true;
+        else if (std::strcmp(name, "GL_ARB_ES3_compatibility") == 0)
+            hasETC2 = true;
+    }
+
+    // ETC2 is core from OpenGL 4.3
+    if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3))
+        hasETC2 = true;
+}
+
+TextureLoader::~TextureLoader() {}
+
+unsigned int TextureLoader::loadAsync(const std::string& path) {
+    unsigned int textureID = createTexture();
+    loadLevelsAsync(textureID, path, 0, -1);
+    return textureID;
+}
+
+unsigned int TextureLoader::createTexture() {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    resetTexture(textureID);
+    return textureID;
+}
+
+void TextureLoader::resetTexture(unsigned int textureID) {
+    // Neutral grey placeholder, sampled without mips until the real data lands
+    const unsigned char placeholder[4] = {128, 128, 128, 255};
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureLoader::loadLevelsAsync(unsigned int textureID, const std::string& path, int firstLevel, int lastLevel) {
+    unsigned int generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingDecodes++;
+        generation = generations[textureID];
+    }
+
+    workers.enqueue([this, textureID, generation, path, firstLevel, lastLevel] {
+        DecodedImage image;
+        image.textureID = textureID;
+        image.generation = generation;
+        image.path = path;
+
+        KtxImage cooked;
+        if (useCooked(path) && readKtx(cookedTexturePath(path), cooked, firstLevel, lastLevel)) {
+            // Cooked levels are read as stored, nothing else is touched
+            image.width = cooked.width;
+            image.height = cooked.height;
+            image.compressedFormat = cooked.glInternalFormat;
+            image.firstLevel = firstLevel;
+            image.pixels = std::move(cooked.data);
+            image.levelOffsets = std::move(cooked.levelOffsets);
+            image.levelSizes = std::move(cooked.levelSizes);
+        } else {
+            unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+            if (data) {
+                buildMipChain(image, data);
+            } else {
+                std::cerr << "Texture failed to load at path: " << path << std::endl;
+            }
+            stbi_image_free(data);
+
+            // Keep only the requested range of the chain, clamped to the levels decoded
+            int levels = static_cast<int>(image.levelOffsets.size());
+            int first = std::clamp(firstLevel, 0, std::max(levels - 1, 0));
+            int last = (lastLevel < 0 || lastLevel >= levels) ? levels - 1 : std::max(lastLevel, first);
+            if (!image.pixels.empty() && (first > 0 || last < levels - 1)) {
+                size_t begin = image.levelOffsets[first];
+                size_t end = image.levelOffsets[last] + image.levelSizes[last];
+                image.pixels.erase(image.pixels.begin() + end, image.pixels.end());
+                image.pixels.erase(image.pixels.begin(), image.pixels.begin() + begin);
+
+                image.levelOffsets.assign(image.levelOffsets.begin() + first, image.levelOffsets.begin() + last + 1);
+                image.levelSizes.assign(image.levelSizes.begin() + first, image.levelSizes.begin() + last + 1);
+                for (auto& offset : image.levelOffsets)
+                    offset -= begin;
+                image.firstLevel = first;
+            }
+        }
+
+        // Failures are queued too, so whoever waits on the levels hears of them
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingDecodes--;
+        decoded.push_back(std::move(image));
+    });
+}
+
+void TextureLoader::processUploads(size_t byteBudget) {
+    size_t uploaded = 0;
+
+    // Always upload at least one image so oversized textures still make progress
+    while (uploaded == 0 || uploaded < byteBudget) {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty())
+                break;
+            image = std::move(decoded.front());
+            decoded.pop_front();
+            if (image.generation != generations[image.textureID])
+                continue;
+        }
+
+        bool succeeded = !image.pixels.empty() && upload(image);
+        uploaded += std::max<size_t>(image.pixels.size(), 1);
+        if (uploadListener)
+            uploadListener(image.textureID, image.firstLevel, succeeded);
+    }
+}
+
+void TextureLoader::cancel(unsigned int textureID) {
+    std::lock_guard<std::mutex> lock(mutex);
+    generations[textureID] = ++generationCounter;
+}
+
+void TextureLoader::setUploadListener(std::function<void(unsigned int, int, bool)> listener) {
+    uploadListener = std::move(listener);
+}
+
+bool TextureLoader::probe(const std::string& path, TextureInfo& info) const {
+    KtxImage cooked;
+    if (useCooked(path) && readKtxHeader(cookedTexturePath(path), cooked)) {
+        info.width = cooked.width;
+        info.height = cooked.height;
+        info.components = 0;
+        info.compressedFormat = cooked.glInternalFormat;
+        return true;
+    }
+
+    info.compressedFormat = 0;
+    return stbi_info(path.c_str(), &info.width, &info.height, &info.components) != 0;
+}
+
+bool TextureLoader::supportsFormat(GLenum compressedFormat) const {
+    switch (compressedFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return hasS3TC;
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        return hasETC2;
+    default:
+        return false;
+    }
+}
+
+bool TextureLoader::useCooked(const std::string& path) const {
+    std::string cookedPath = cookedTexturePath(path);
+    std::error_code error;
+    if (cookedPath == path || !std::filesystem::exists(cookedPath, error))
+        return false;
+
+    // A source edited after cooking wins over the stale cooked file
+    if (std::filesystem::last_write_time(cookedPath, error) < std::filesystem::last_write_time(path, error))
+        return false;
+
+    KtxImage header;
+    return readKtxHeader(cookedPath, header) && supportsFormat(header.glInternalFormat);
+}
+
+bool TextureLoader::isIdle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pendingDecodes == 0 && decoded.empty();
+}
+
+bool TextureLoader::upload(const DecodedImage& image) {
+    // The texture may have been released while it was still decoding
+    if (!glIsTexture(image.textureID))
+        return false;
+
+    if (pbos[0] == 0)
+        glGenBuffers(2, pbos);
+
+    GLenum format = GL_RGB;
+    if (image.components == 1)
+        format = GL_RED;
+    else if (image.components == 3)
+        format = GL_RGB;
+    else if (image.components == 4)
+        format = GL_RGBA;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+    nextPbo = (nextPbo + 1) % 2;
+
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, image.pixels.size(), nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.pixels.size(),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        std::cerr << "Failed to map pixel buffer for: " << image.path << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    std::memcpy(mapped, image.pixels.data(), image.pixels.size());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // Rows of 1 and 3 channel images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, image.textureID);
+
+    int levels = static_cast<int>(image.levelOffsets.size());
+    for (int i = 0; i < levels; i++) {
+        int level = image.firstLevel + i;
+        int w = std::max(1, image.width >> level);
+        int h = std::max(1, image.height >> level);
+        // With a PBO bound the data pointer is an offset, and the copy is asynchronous
+        if (image.compressedFormat) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image.compressedFormat, w, h, 0,
+                static_cast<GLsizei>(image.levelSizes[i]), (void*)image.levelOffsets[i]);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, format, GL_UNSIGNED_BYTE,
+                (void*)image.levelOffsets[i]);
+        }
+    }
+
+    // Sampling starts at the finest uploaded level; anything below it stays undefined
+    TextureInfo info{image.width, image.height, image.components, image.compressedFormat};
+    GLint baseLevel = 0, maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    if (maxLevel == 0 || image.firstLevel < baseLevel)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, image.firstLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, info.levelCount() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+}
+
+void buildMipChain(DecodedImage& image, const unsigned char* level0) {
+    const int c = image.components;
+
+    // Total size of the chain, so the pixels are allocated once
+    size_t total = 0;
+    for (int w = image.width, h = image.height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        image.levelOffsets.push_back(total);
+        image.levelSizes.push_back(static_cast<size_t>(w) * h * c);
+        total += image.levelSizes.back();
+        if (w == 1 && h == 1)
+            break;
+    }
+
+    image.pixels.resize(total);
+    std::memcpy(image.pixels.data(), level0, static_cast<size_t>(image.width) * image.height * c);
+
+    for (size_t level = 1; level < image.levelOffsets.size(); level++) {
+        int srcW = std::max(1, image.width >> (level - 1));
+        int srcH = std::max(1, image.height >> (level - 1));
+        int dstW = std::max(1, srcW / 2);
+        int dstH = std::max(1, srcH / 2);
+
+        const unsigned char* src = image.pixels.data() + image.levelOffsets[level - 1];
+        unsigned char* dst = image.pixels.data() + image.levelOffsets[level];
+
+        for (int y = 0; y < dstH; y++) {
+            int y0 = std::min(y * 2, srcH - 1);
+            int y1 = std::min(y * 2 + 1, srcH - 1);
+            for (int x = 0; x < dstW; x++) {
+                int x0 = std::min(x * 2, srcW - 1);
+                int x1 = std::min(x * 2 + 1, srcW - 1);
+                for (int ch = 0; ch < c; ch++) {
+                    int sum = src[(y0 * srcW + x0) * c + ch] + src[(y0 * srcW + x1) * c + ch]
+                            + src[(y1 * srcW + x0) * c + ch] + src[(y1 * srcW + x1) * c + ch];
+                    dst[(y * dstW + x) * c + ch] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
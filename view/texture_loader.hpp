@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <glad/glad.hpp>
+#include "thread_pool.hpp"
+
+// Dimensions and storage of a texture as it will be uploaded
+struct TextureInfo {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    // Non-zero for block-compressed data read from a cooked KTX file
+    GLenum compressedFormat = 0;
+
+    int levelCount() const;
+    size_t levelBytes(int level) const;
+};
+
+// Range of mip levels produced on a worker thread, ready for upload
+struct DecodedImage {
+    unsigned int textureID = 0;
+    unsigned int generation = 0;
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    GLenum compressedFormat = 0;
+    // Mip level held by the first entry of levelOffsets
+    int firstLevel = 0;
+    // Levels packed back to back, finest first. Empty when the load failed
+    std::vector<unsigned char> pixels;
+    std::vector<size_t> levelOffsets;
+    std::vector<size_t> levelSizes;
+};
+
+// Decodes textures on worker threads, or reads their cooked KTX counterpart
+// when one exists and the GPU supports its format. Results are streamed to
+// the GPU through pixel buffer objects a few megabytes per frame, so loads
+// never stall rendering
+class TextureLoader {
+public:
+    static TextureLoader& instance();
+
+    // Returns a usable texture name right away; it shows a 1x1 placeholder
+    // until its pixels have been uploaded by processUploads()
+    unsigned int loadAsync(const std::string& path);
+
+    // Placeholder texture whose levels are filled in later by loadLevelsAsync()
+    unsigned int createTexture();
+
+    // Puts an existing texture back to the placeholder, before levels of a new shape arrive
+    void resetTexture(unsigned int textureID);
+
+    // Loads mip levels [firstLevel, lastLevel] of an image in the background.
+    // Once uploaded, firstLevel becomes the texture's base level if it is finer
+    void loadLevelsAsync(unsigned int textureID, const std::string& path, int firstLevel, int lastLevel);
+
+    // Drops every load still pending for a texture about to be deleted, so
+    // a name reused by glGenTextures never receives stale levels
+    void cancel(unsigned int textureID);
+
+    // Uploads finished decodes, called once per frame from the GL thread
+    void processUploads(size_t byteBudget = 8 * 1024 * 1024);
+
+    // Called on the GL thread once per loadLevelsAsync() not cancelled, with the
+    // finest level it added, or uploaded false when nothing could be loaded
+    void setUploadListener(std::function<void(unsigned int textureID, int firstLevel, bool uploaded)> listener);
+
+    // What loading path would produce: cooked format if usable, else the source header
+    bool probe(const std::string& path, TextureInfo& info) const;
+
+    bool isIdle();
+
+    bool supportsFormat(GLenum compressedFormat) const;
+
+private:
+    TextureLoader();
+    ~TextureLoader();
+
+    bool upload(const DecodedImage& image);
+    bool useCooked(const std::string& path) const;
+
+    std::mutex mutex;
+    std::deque<DecodedImage> decoded;
+    unsigned int pendingDecodes = 0;
+    // Bumped by cancel(); loads tagged with an older generation are discarded
+    std::unordered_map<unsigned int, unsigned int> generations;
+    unsigned int generationCounter = 0;
+    std::function<void(unsigned int, int, bool)> uploadListener;
+
+    // Alternating PBOs, orphaned before each write so the driver never waits on the GPU
+    GLuint pbos[2] = {0, 0};
+    int nextPbo = 0;
+
+    bool hasS3TC = false;
+    bool hasETC2 = false;
+
+    // Declared last so workers are joined before the queue above is destroyed
+    ThreadPool workers;
+};
+
+// Box-filters a tightly packed image down to 1x1, level 0 included
+void buildMipChain(DecodedImage& image, const unsigned char* level0);
@@ -0,0 +1,393 @@
+#include "texture_manager.hpp"
+#include <glad/glad.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <iostream>
+
+// Textures first arrive with their longest edge at most this many texels
+constexpr int STREAM_START_SIZE = 128;
+// Frames without a request before a texture counts as unused
+constexpr uint64_t STREAM_UNUSED_FRAMES = 120;
+// Stream-ins in flight at once, so one skin swap cannot flood the decoders
+constexpr int STREAM_MAX_PENDING = 4;
+
+namespace {
+
+// FNV-1a over the raw file bytes
+uint64_t hashFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    uint64_t hash = 14695981039346656037ull;
+    std::vector<char> buffer(64 * 1024);
+
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize count = file.gcount();
+        for (std::streamsize i = 0; i < count; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// Finest level whose longest edge is within STREAM_START_SIZE
+int streamStartLevel(const TextureInfo& info) {
+    int level = 0;
+    while (level < info.levelCount() - 1 && std::max(info.width, info.height) >> level > STREAM_START_SIZE)
+        level++;
+    return level;
+}
+
+}
+
+TextureHandle::TextureHandle(TextureBinding* binding) : binding(binding) {
+    if (binding) {
+        binding->refCount++;
+        binding->entry->refCount++;
+    }
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other) : TextureHandle(other.binding) {}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept : binding(other.binding) {
+    other.binding = nullptr;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept {
+    std::swap(binding, other.binding);
+    return *this;
+}
+
+TextureHandle::~TextureHandle() {
+    if (binding)
+        TextureManager::instance().release(binding);
+}
+
+TextureManager& TextureManager::instance() {
+    static TextureManager manager;
+    return manager;
+}
+
+TextureManager::TextureManager() {
+    TextureLoader::instance().setUploadListener([this](unsigned int textureID, int firstLevel, bool uploaded) {
+        onUploaded(textureID, firstLevel, uploaded);
+    });
+}
+
+TextureHandle TextureManager::acquire(const std::string& path, size_t* bytesShared) {
+    std::error_code error;
+    std::string resolved = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        resolved = path;
+
+    auto pathIt = byPath.find(resolved);
+    if (pathIt != byPath.end()) {
+        if (bytesShared)
+            *bytesShared += pathIt->second->entry->vramBytes;
+        return TextureHandle(pathIt->second.get());
+    }
+
+    uint64_t contentHash = hashFile(resolved);
+    auto hashIt = byHash.find(contentHash);
+    TextureEntry* entry;
+    if (hashIt != byHash.end()) {
+        entry = hashIt->second.get();
+        if (bytesShared)
+            *bytesShared += entry->vramBytes;
+    } else {
+        entry = createEntry(resolved, contentHash);
+    }
+
+    auto binding = std::make_unique<TextureBinding>();
+    binding->entry = entry;
+    TextureBinding* raw = binding.get();
+    byPath[resolved] = std::move(binding);
+    return TextureHandle(raw);
+}
+
+TextureEntry* TextureManager::createEntry(const std::string& resolved, uint64_t contentHash) {
+    auto entry = std::make_unique<TextureEntry>();
+    entry->path = resolved;
+    entry->contentHash = contentHash;
+    entry->lastUsedFrame = frame;
+
+    TextureLoader& loader = TextureLoader::instance();
+    entry->texture = GLTexture(loader.createTexture());
+    if (loader.probe(resolved, entry->info)) {
+        int levels = entry->info.levelCount();
+        entry->vramBytes = bytesFrom(*entry, 0);
+
+        // Start from the coarse end of the chain, the streamer refines from there
+        int startLevel = streamStartLevel(entry->info);
+        entry->residentLevel = levels;
+        entry->wantedLevel = startLevel;
+        entry->streaming = true;
+        loader.loadLevelsAsync(entry->texture.get(), resolved, startLevel, -1);
+    } else {
+        std::cerr << "Texture failed to load at path: " << resolved << std::endl;
+    }
+
+    TextureEntry* raw = entry.get();
+    byId[raw->texture.get()] = raw;
+    byHash[contentHash] = std::move(entry);
+    return raw;
+}
+
+void TextureManager::rebind(TextureBinding& binding, TextureEntry* entry) {
+    binding.entry->refCount -= binding.refCount;
+    if (binding.entry->refCount == 0)
+        binding.entry->lastUsedFrame = frame;
+    binding.entry = entry;
+    entry->refCount += binding.refCount;
+    entry->lastUsedFrame = frame;
+}
+
+bool TextureManager::reload(const std::string& path) {
+    std::error_code error;
+    std::string resolved = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        resolved = path;
+
+    auto pathIt = byPath.find(resolved);
+    if (pathIt == byPath.end())
+        return false;
+
+    TextureBinding& binding = *pathIt->second;
+    TextureEntry* entry = binding.entry;
+    TextureLoader& loader = TextureLoader::instance();
+    TextureInfo info;
+    if (!loader.probe(resolved, info)) {
+        std::cerr << "Texture failed to reload at path: " << resolved << std::endl;
+        return false;
+    }
+
+    // New content already cached under another entry: share that one
+    uint64_t contentHash = hashFile(resolved);
+    auto hashIt = byHash.find(contentHash);
+    if (hashIt != byHash.end() && hashIt->second.get() != entry) {
+        rebind(binding, hashIt->second.get());
+        return true;
+    }
+
+    // Paths deduped onto the entry still hold its image, so it stays theirs and
+    // streams from one of their files; this path gets a texture of its own
+    TextureBinding* other = nullptr;
+    for (auto& pair : byPath) {
+        if (pair.second.get() != &binding && pair.second->entry == entry)
+            other = pair.second.get();
+    }
+    if (other) {
+        if (contentHash == entry->contentHash)
+            return true;
+        if (entry->path == resolved) {
+            for (auto& pair : byPath) {
+                if (pair.second.get() == other)
+                    entry->path = pair.first;
+            }
+            // A pending load reads the changed file; updateStreaming() asks again
+            loader.cancel(entry->texture.get());
+            entry->streaming = false;
+        }
+        rebind(binding, createEntry(resolved, contentHash));
+        return true;
+    }
+
+    // Whatever was still loading holds the old content
+    loader.cancel(entry->texture.get());
+    if (entry->residentLevel < entry->info.levelCount())
+        residentTotal -= bytesFrom(*entry, entry->residentLevel);
+
+    // Same shape: the resident levels are replaced in place, without a visible gap.
+    // Otherwise the old levels no longer match and the texture starts over
+    int firstLevel;
+    if (info.width == entry->info.width && info.height == entry->info.height &&
+        info.compressedFormat == entry->info.compressedFormat) {
+        firstLevel = std::min(entry->residentLevel, info.levelCount() - 1);
+    } else {
+        loader.resetTexture(entry->texture.get());
+        firstLevel = streamStartLevel(info);
+        entry->wantedLevel = firstLevel;
+    }
+
+    entry->info = info;
+    entry->vramBytes = bytesFrom(*entry, 0);
+    entry->residentLevel = info.levelCount();
+    entry->streaming = true;
+    entry->loadFailed = false;
+    loader.loadLevelsAsync(entry->texture.get(), resolved, firstLevel, -1);
+
+    // Keep the content index honest
+    if (contentHash != entry->contentHash) {
+        std::unique_ptr<TextureEntry> owned = std::move(byHash[entry->contentHash]);
+        byHash.erase(entry->contentHash);
+        entry->contentHash = contentHash;
+        byHash[contentHash] = std::move(owned);
+    }
+    return true;
+}
+
+void TextureManager::requestDetail(const TextureHandle& texture, float screenPixels) {
+    TextureEntry* entry = texture.binding ? texture.binding->entry : nullptr;
+    if (!entry || entry->info.width == 0)
+        return;
+
+    // Finest level whose texels are still no smaller than a screen pixel
+    float texels = static_cast<float>(std::max(entry->info.width, entry->info.height));
+    int level = static_cast<int>(std::floor(std::log2(texels / std::max(screenPixels, 1.0f))));
+    level = std::clamp(level, 0, entry->info.levelCount() - 1);
+
+    if (entry->lastUsedFrame != frame) {
+        entry->wantedLevel = level;
+        entry->lastUsedFrame = frame;
+    } else {
+        entry->wantedLevel = std::min(entry->wantedLevel, level);
+    }
+}
+
+void TextureManager::updateStreaming() {
+    // Over budget: unreferenced textures go first, least recently used first
+    if (residentTotal > budgetBytes) {
+        std::vector<TextureEntry*> unused;
+        for (auto& pair : byHash) {
+            if (pair.second->refCount == 0)
+                unused.push_back(pair.second.get());
+        }
+        std::sort(unused.begin(), unused.end(), [](const TextureEntry* a, const TextureEntry* b) {
+            return a->lastUsedFrame < b->lastUsedFrame;
+        });
+        for (TextureEntry* entry : unused) {
+            if (residentTotal <= budgetBytes)
+                break;
+            destroy(entry);
+        }
+    }
+
+    std::vector<TextureEntry*> entries;
+    int pending = 0;
+    for (auto& pair : byHash) {
+        TextureEntry* entry = pair.second.get();
+        if (entry->info.width == 0)
+            continue;
+        if (entry->streaming)
+            pending++;
+
+        // Unused textures only want their coarsest level
+        if (frame - entry->lastUsedFrame > STREAM_UNUSED_FRAMES)
+            entry->wantedLevel = entry->info.levelCount() - 1;
+        entries.push_back(entry);
+    }
+
+    // Still over budget: drop levels finer than wanted, least recently used first
+    if (residentTotal > budgetBytes) {
+        std::sort(entries.begin(), entries.end(), [](const TextureEntry* a, const TextureEntry* b) {
+            return a->lastUsedFrame < b->lastUsedFrame;
+        });
+        for (TextureEntry* entry : entries) {
+            if (residentTotal <= budgetBytes)
+                break;
+            if (!entry->streaming && entry->wantedLevel > entry->residentLevel)
+                evictTo(*entry, entry->wantedLevel);
+        }
+    }
+
+    // Stream in where the most detail is missing, while it fits the budget
+    std::sort(entries.begin(), entries.end(), [](const TextureEntry* a, const TextureEntry* b) {
+        return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+    });
+    for (TextureEntry* entry : entries) {
+        if (pending >= STREAM_MAX_PENDING)
+            break;
+        if (entry->streaming || entry->loadFailed || entry->wantedLevel >= entry->residentLevel)
+            continue;
+
+        size_t extra = bytesFrom(*entry, entry->wantedLevel) - bytesFrom(*entry, entry->residentLevel);
+        if (residentTotal + extra > budgetBytes)
+            continue;
+
+        entry->streaming = true;
+        pending++;
+        TextureLoader::instance().loadLevelsAsync(entry->texture.get(), entry->path, entry->wantedLevel, entry->residentLevel - 1);
+    }
+
+    frame++;
+}
+
+void TextureManager::onUploaded(unsigned int textureID, int firstLevel, bool uploaded) {
+    auto it = byId.find(textureID);
+    if (it == byId.end())
+        return;
+
+    // A broken or half-written file frees its stream-in slot and waits for a reload
+    TextureEntry& entry = *it->second;
+    entry.streaming = false;
+    if (!uploaded) {
+        entry.loadFailed = true;
+        return;
+    }
+    if (firstLevel < entry.residentLevel) {
+        residentTotal += bytesFrom(entry, firstLevel) - bytesFrom(entry, entry.residentLevel);
+        entry.residentLevel = firstLevel;
+    }
+}
+
+size_t TextureManager::bytesFrom(const TextureEntry& entry, int firstLevel) const {
+    size_t bytes = 0;
+    for (int level = firstLevel; level < entry.info.levelCount(); level++)
+        bytes += entry.info.levelBytes(level);
+    return bytes;
+}
+
+void TextureManager::evictTo(TextureEntry& entry, int level) {
+    glBindTexture(GL_TEXTURE_2D, entry.texture.get());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+    // Redefining a level as 0x0 releases its storage while keeping the texture name
+    for (int dropped = entry.residentLevel; dropped < level; dropped++) {
+        if (entry.info.compressedFormat)
+            glCompressedTexImage2D(GL_TEXTURE_2D, dropped, entry.info.compressedFormat, 0, 0, 0, 0, nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, dropped, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    residentTotal -= bytesFrom(entry, entry.residentLevel) - bytesFrom(entry, level);
+    entry.residentLevel = level;
+}
+
+size_t TextureManager::unloadUnused() {
+    size_t before = residentTotal;
+    std::vector<TextureEntry*> unused;
+    for (auto& pair : byHash) {
+        if (pair.second->refCount == 0)
+            unused.push_back(pair.second.get());
+    }
+    for (TextureEntry* entry : unused)
+        destroy(entry);
+    return before - residentTotal;
+}
+
+void TextureManager::release(TextureBinding* binding) {
+    // Kept resident so switching back to it is free; updateStreaming() evicts it under pressure
+    binding->refCount--;
+    if (--binding->entry->refCount == 0)
+        binding->entry->lastUsedFrame = frame;
+}
+
+void TextureManager::destroy(TextureEntry* entry) {
+    for (auto it = byPath.begin(); it != byPath.end(); ) {
+        if (it->second->entry == entry)
+            it = byPath.erase(it);
+        else
+            ++it;
+    }
+
+    TextureLoader::instance().cancel(entry->texture.get());
+    byId.erase(entry->texture.get());
+    if (entry->residentLevel < entry->info.levelCount())
+        residentTotal -= bytesFrom(*entry, entry->residentLevel);
+    // Deletes the GL texture along with the entry
+    byHash.erase(entry->contentHash);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "texture_loader.hpp"
+#include "gl_resource.hpp"
+
+// One GPU texture per distinct image content, shared by every model using it.
+// Entries stay resident at zero references until evicted or unloaded
+struct TextureEntry {
+    GLTexture texture;
+    std::string path;          // resolved path of the first load
+    uint64_t contentHash = 0;
+    size_t vramBytes = 0;      // full mip chain
+    int refCount = 0;
+
+    // Streaming state. Levels count from 0 (finest); levelCount means none resident
+    TextureInfo info;
+    int residentLevel = 0;
+    int wantedLevel = 0;
+    bool streaming = false;
+    bool loadFailed = false;   // no more stream-ins until the file is reloaded
+    uint64_t lastUsedFrame = 0;
+};
+
+// A path textures were acquired through and the entry holding its content.
+// Handles go through it, so a path whose file changes can move to an entry
+// of its own while the other paths sharing the old one keep their image
+struct TextureBinding {
+    TextureEntry* entry = nullptr;
+    int refCount = 0;
+};
+
+// Reference-counted handle to a shared texture, released with its last copy
+class TextureHandle {
+public:
+    TextureHandle() = default;
+    TextureHandle(const TextureHandle& other);
+    TextureHandle(TextureHandle&& other) noexcept;
+    TextureHandle& operator=(TextureHandle other) noexcept;
+    ~TextureHandle();
+
+    unsigned int id() const { return binding ? binding->entry->texture.get() : 0; }
+    size_t vramBytes() const { return binding ? binding->entry->vramBytes : 0; }
+    explicit operator bool() const { return binding != nullptr; }
+
+private:
+    friend class TextureManager;
+    explicit TextureHandle(TextureBinding* binding);
+
+    TextureBinding* binding = nullptr;
+};
+
+// Process-wide texture cache. Lookups go by resolved path first, then by a
+// hash of the file content so copies of one image under different names
+// are decoded and uploaded only once.
+//
+// Textures are streamed per mip level: they start with only their small mips
+// resident, finer levels are loaded in the background once something is drawn
+// large enough to need them, and levels nobody needs are dropped again when
+// the resident total goes over the VRAM budget. Textures no model holds any
+// more are the first to go, least recently used first
+class TextureManager {
+public:
+    static TextureManager& instance();
+
+    // bytesShared is incremented by the VRAM a cache hit avoided allocating
+    TextureHandle acquire(const std::string& path, size_t* bytesShared = nullptr);
+
+    // Reloads the levels of a cached texture whose file changed; false if it was never loaded.
+    // A path sharing its entry with other paths moves to an entry of its own
+    bool reload(const std::string& path);
+
+    // Asks for enough detail to cover screenPixels on the texture's longest edge this frame
+    void requestDetail(const TextureHandle& texture, float screenPixels);
+
+    // Issues stream-ins and evictions for this frame's requests, once per frame
+    void updateStreaming();
+
+    // Deletes every texture no handle refers to, returning the bytes freed
+    size_t unloadUnused();
+
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    size_t getBudget() const { return budgetBytes; }
+    size_t residentBytes() const { return residentTotal; }
+    size_t textureCount() const { return byHash.size(); }
+
+private:
+    friend class TextureHandle;
+    TextureManager();
+
+    TextureEntry* createEntry(const std::string& resolved, uint64_t contentHash);
+    // Moves the binding and the references through it over to entry
+    void rebind(TextureBinding& binding, TextureEntry* entry);
+    void release(TextureBinding* binding);
+    void onUploaded(unsigned int textureID, int firstLevel, bool uploaded);
+    size_t bytesFrom(const TextureEntry& entry, int firstLevel) const;
+    void evictTo(TextureEntry& entry, int level);
+    void destroy(TextureEntry* entry);
+
+    std::unordered_map<std::string, std::unique_ptr<TextureBinding>> byPath;
+    std::unordered_map<unsigned int, TextureEntry*> byId;
+    std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>> byHash;
+
+    size_t budgetBytes = 512 * 1024 * 1024;
+    size_t residentTotal = 0;
+    uint64_t frame = 0;
+};
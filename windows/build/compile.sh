@@ -36,7 +36,7 @@ cd ../../../..
 cp -r bladewire/windows/libs bladewire/dependencies/openal-soft-1.23.1/
 cd bladewire
 
-x86_64-w64-mingw32-g++ main.cpp controller/game_controller.cpp view/renderer.cpp view/model.cpp view/animation/animation.cpp model/audio_manager.cpp view/glad/src/glad.cpp \
+x86_64-w64-mingw32-g++ main.cpp controller/game_controller.cpp view/renderer.cpp view/model.cpp view/model_cache.cpp view/skin_registry.cpp view/mesh_optimizer.cpp view/thread_pool.cpp view/hot_reload.cpp view/texture_loader.cpp view/texture_manager.cpp view/texture_compressor.cpp view/animation/animation.cpp view/animation/clip_compressor.cpp view/animation/animation_library.cpp view/animation/pose.cpp view/animation/pose_kernels.cpp view/animation/character_animation.cpp view/animation/animation_system.cpp view/animation/baked_animation.cpp view/crowd.cpp model/audio_manager.cpp view/glad/src/glad.cpp \
 -Iview/glad/include -Icontroller -Iview -Imodel \
 -o bladewire.exe \
 -L/usr/x86_64-w64-0mingw32/lib -L/home/user0/bladewire/dependencies/openal-soft-1.23.1/libs/Win64 \